@@ -0,0 +1,560 @@
+// Measures renderer initialization and steady-state frame throughput and prints the results
+// as JSON (default) or CSV so that they can be collected by a build system and compared
+// across builds.
+//
+//     Benchmark [--frames N] [--warmup N] [--width W] [--height H] [--frames-in-flight N]
+//               [--instances N | --instance-sweep [MAX]] [--instances-per-draw N]
+//               [--threads N | --thread-sweep [MAX]] [--record-every-frame] [--windowed]
+//               [--device INDEX|UUID] [--timeline] [--dynamic-rendering]
+//               [--format json|csv] [--output FILE]
+//
+// --instances draws the triangle N times with a single instanced draw. --instance-sweep
+// measures 1, 10, 100, ... up to MAX (default 1000000) instances in one run and reports
+// the frame rate and CPU cost at each step, showing where GPU work rather than CPU
+// submission starts to limit the frame rate.
+//
+// --instances-per-draw splits the instances into many draws, and --threads records those
+// draws into secondary command buffers on N threads. --thread-sweep measures 1, 2, 4, ...
+// up to MAX (default: the number of hardware threads) recording threads in one run.
+// The scene is static, so by default each frame resubmits its unchanged command buffer;
+// --record-every-frame records it every frame, which is what the thread counts compare.
+// "recording" in the results counts the measured frames that were recorded and reused.
+//
+// --device renders on the given device rather than the highest scoring one, overriding the
+// VULKAN_DEVICE environment variable; see DeviceSelector.
+//
+// --timeline paces frames with timeline semaphores where Vulkan 1.2 is available; "sync" in the
+// results says whether they were used. --dynamic-rendering renders without render pass and
+// framebuffer objects where VK_KHR_dynamic_rendering or Vulkan 1.3 is available; "rendering" says
+// which path was taken.
+//
+// Headless runs use VulkanOffscreenRenderer and need no display, so they work with a
+// software driver such as lavapipe. --windowed renders through VulkanCanvas in a wxWidgets
+// frame and is only available where VulkanCanvas has a surface backend.
+#include "VulkanOffscreenRenderer.h"
+#include "VulkanException.h"
+#include "FrameProfiler.h"
+#if defined(_WIN32) || defined(__WXGTK__)
+#include <wx/wxprec.h>
+#include "VulkanCanvas.h"
+#define BENCHMARK_HAS_WINDOWED 1
+#endif
+#ifdef _WIN32
+#ifdef _UNICODE
+#ifdef _DEBUG
+#pragma comment(lib, "wxbase31ud.lib")
+#else
+#pragma comment(lib, "wxbase31u.lib")
+#endif
+#else
+#ifdef _DEBUG
+#pragma comment(lib, "wxbase31d.lib")
+#else
+#pragma comment(lib, "wxbase31.lib")
+#endif
+#endif
+#endif
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+struct BenchmarkOptions {
+    uint32_t frames = 1000;
+    uint32_t warmupFrames = 60;
+    uint32_t width = 800;
+    uint32_t height = 600;
+    uint32_t framesInFlight = VulkanRenderer::DEFAULT_FRAMES_IN_FLIGHT;
+    uint32_t instances = 1;
+    // 0 unless --instance-sweep was given
+    uint32_t sweepMaxInstances = 0;
+    // 0 draws all instances at once
+    uint32_t instancesPerDraw = 0;
+    uint32_t threads = 1;
+    // 0 unless --thread-sweep was given
+    uint32_t sweepMaxThreads = 0;
+    bool recordEveryFrame = false;
+    bool windowed = false;
+    bool timeline = false;
+    bool dynamicRendering = false;
+    bool csv = false;
+    // index or UUID; empty to use VULKAN_DEVICE or the highest scoring device
+    std::string device;
+    std::string outputFile;
+};
+
+// One step of an instance or thread sweep
+struct SweepPoint {
+    uint32_t instances = 0;
+    uint32_t threads = 0;
+    uint32_t draws = 0;
+    double framesPerSecond = 0.0;
+    double cpuFrameMean = 0.0;
+    double cpuFrameP95 = 0.0;
+    double recordMean = 0.0;
+    double submitMean = 0.0;
+    double gpuRenderPassMean = 0.0;
+    RecordingStatistics recording;
+};
+
+struct BenchmarkResult {
+    std::string mode;
+    std::string deviceName;
+    // "timeline" or "binary"
+    std::string sync;
+    // "dynamic" or "render_pass"
+    std::string rendering;
+    std::vector<InitStepTiming> initTimings;
+    // wall-clock time to construct the renderer; less than the sum of the steps when they overlap
+    double initMilliseconds = 0.0;
+    double elapsedSeconds = 0.0;
+    TimingHistogram frameTimes;
+    // counted over the measured frames only
+    RecordingStatistics recording;
+    const FrameProfiler* profiler = nullptr;
+    std::vector<SweepPoint> sweep;
+    // "instance" or "thread" when sweep is not empty
+    std::string sweepName;
+
+    BenchmarkResult(uint32_t frames) : frameTimes(frames) {}
+};
+
+static void PrintUsage()
+{
+    std::cerr << "Usage: Benchmark [--frames N] [--warmup N] [--width W] [--height H]\n"
+        "                 [--frames-in-flight N] [--instances N | --instance-sweep [MAX]]\n"
+        "                 [--instances-per-draw N] [--threads N | --thread-sweep [MAX]]\n"
+        "                 [--record-every-frame] [--windowed] [--device INDEX|UUID]\n"
+        "                 [--timeline] [--dynamic-rendering] [--format json|csv] [--output FILE]\n";
+}
+
+static bool ParseOptions(int argc, char* argv[], BenchmarkOptions& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--windowed") {
+            options.windowed = true;
+        }
+        else if (arg == "--timeline") {
+            options.timeline = true;
+        }
+        else if (arg == "--dynamic-rendering") {
+            options.dynamicRendering = true;
+        }
+        else if (arg == "--record-every-frame") {
+            options.recordEveryFrame = true;
+        }
+        else if (arg == "--frames" && hasValue) {
+            options.frames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--warmup" && hasValue) {
+            options.warmupFrames = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--width" && hasValue) {
+            options.width = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--height" && hasValue) {
+            options.height = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--frames-in-flight" && hasValue) {
+            options.framesInFlight = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--instances" && hasValue) {
+            options.instances = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--instance-sweep") {
+            options.sweepMaxInstances = 1000000;
+            if (hasValue && argv[i + 1][0] != '-') {
+                options.sweepMaxInstances = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+        }
+        else if (arg == "--instances-per-draw" && hasValue) {
+            options.instancesPerDraw = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--threads" && hasValue) {
+            options.threads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (arg == "--thread-sweep") {
+            options.sweepMaxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+            if (hasValue && argv[i + 1][0] != '-') {
+                options.sweepMaxThreads = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+            }
+        }
+        else if (arg == "--format" && hasValue) {
+            std::string format = argv[++i];
+            if (format != "json" && format != "csv") {
+                return false;
+            }
+            options.csv = format == "csv";
+        }
+        else if (arg == "--device" && hasValue) {
+            options.device = argv[++i];
+        }
+        else if (arg == "--output" && hasValue) {
+            options.outputFile = argv[++i];
+        }
+        else {
+            return false;
+        }
+    }
+    return options.frames > 0 && options.width > 0 && options.height > 0 && options.framesInFlight > 0 &&
+        options.instances > 0 && options.threads > 0 &&
+        (options.sweepMaxInstances == 0 || options.sweepMaxThreads == 0);
+}
+
+// count triangles on a square grid covering the viewport, each rotated and tinted differently
+// so that the rasterizer cannot skip any of them
+static std::vector<InstanceData> CreateInstanceGrid(uint32_t count)
+{
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(count))));
+    float cell = 2.0f / side;
+    std::vector<InstanceData> instances(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        InstanceData& instance = instances[i];
+        uint32_t column = i % side;
+        uint32_t row = i / side;
+        instance.offset[0] = -1.0f + cell * (column + 0.5f);
+        instance.offset[1] = -1.0f + cell * (row + 0.5f);
+        instance.scale = cell * 0.9f;
+        instance.rotation = 0.1f * (i % 63);
+        instance.color[0] = 0.5f + 0.5f * (column % 2);
+        instance.color[1] = 0.5f + 0.5f * (row % 2);
+        instance.color[2] = 1.0f;
+        instance.color[3] = 1.0f;
+    }
+    return instances;
+}
+
+// Renders the warm-up frames, then the measured frames, timing each RenderFrame call.
+// The clock stops only once the GPU has finished, so the frame rate includes GPU time.
+template<typename RenderOne>
+static void RunFrames(const BenchmarkOptions& options, VulkanRenderer& renderer, RenderOne renderOne,
+    BenchmarkResult& result)
+{
+    for (uint32_t i = 0; i < options.warmupFrames; ++i) {
+        renderOne();
+    }
+    renderer.WaitIdle();
+    renderer.GetFrameProfiler().Clear();
+    RecordingStatistics recording = renderer.GetRecordingStatistics();
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < options.frames; ++i) {
+        auto frameStart = std::chrono::steady_clock::now();
+        renderOne();
+        auto frameEnd = std::chrono::steady_clock::now();
+        result.frameTimes.AddSample(std::chrono::duration<double, std::milli>(frameEnd - frameStart).count());
+    }
+    renderer.WaitIdle();
+    auto end = std::chrono::steady_clock::now();
+    result.elapsedSeconds = std::chrono::duration<double>(end - start).count();
+    const RecordingStatistics& total = renderer.GetRecordingStatistics();
+    result.recording.framesRecorded = total.framesRecorded - recording.framesRecorded;
+    result.recording.framesReused = total.framesReused - recording.framesReused;
+    result.recording.imageMisses = total.imageMisses - recording.imageMisses;
+
+    result.deviceName = renderer.GetDeviceName();
+    result.sync = renderer.GetContext()->UsesTimelineSemaphores() ? "timeline" : "binary";
+    result.rendering = renderer.GetContext()->UsesDynamicRendering() ? "dynamic" : "render_pass";
+    result.initTimings = renderer.GetInitTimings();
+    result.profiler = &renderer.GetFrameProfiler();
+}
+
+// Runs the frames and records one step of a sweep
+template<typename RenderOne>
+static void RunSweepPoint(const BenchmarkOptions& options, VulkanRenderer& renderer, RenderOne renderOne,
+    BenchmarkResult& result)
+{
+    result.frameTimes.Clear();
+    RunFrames(options, renderer, renderOne, result);
+
+    const FrameProfiler& profiler = renderer.GetFrameProfiler();
+    SweepPoint point;
+    point.instances = renderer.GetInstanceCount();
+    point.threads = renderer.GetRecordingThreads();
+    point.draws = renderer.GetDrawCount();
+    point.framesPerSecond = options.frames / result.elapsedSeconds;
+    point.cpuFrameMean = result.frameTimes.Mean();
+    point.cpuFrameP95 = result.frameTimes.Percentile(95.0);
+    point.recordMean = profiler.GetHistogram(FrameStage::Record).Mean();
+    point.submitMean = profiler.GetHistogram(FrameStage::Submit).Mean();
+    point.gpuRenderPassMean = profiler.GetHistogram(FrameStage::GpuRenderPass).Mean();
+    point.recording = result.recording;
+    result.sweep.push_back(point);
+}
+
+// Either a single run with options.instances instances on options.threads threads, one run per
+// power of ten up to options.sweepMaxInstances instances, or one run per power of two up to
+// options.sweepMaxThreads recording threads.
+template<typename RenderOne>
+static void RunInstances(const BenchmarkOptions& options, VulkanRenderer& renderer, RenderOne renderOne,
+    BenchmarkResult& result)
+{
+    renderer.SetReuseCommandBuffers(!options.recordEveryFrame);
+    renderer.SetInstancesPerDraw(options.instancesPerDraw);
+    renderer.SetRecordingThreads(options.threads);
+    if (options.sweepMaxThreads != 0) {
+        result.sweepName = "thread";
+        renderer.SetInstances(CreateInstanceGrid(options.instances));
+        for (uint32_t threads = 1; threads <= options.sweepMaxThreads; threads *= 2) {
+            renderer.SetRecordingThreads(threads);
+            RunSweepPoint(options, renderer, renderOne, result);
+        }
+        return;
+    }
+    if (options.sweepMaxInstances == 0) {
+        renderer.SetInstances(CreateInstanceGrid(options.instances));
+        RunFrames(options, renderer, renderOne, result);
+        return;
+    }
+    result.sweepName = "instance";
+    uint64_t instances = 1;
+    while (instances <= options.sweepMaxInstances) {
+        renderer.SetInstances(CreateInstanceGrid(static_cast<uint32_t>(instances)));
+        RunSweepPoint(options, renderer, renderOne, result);
+        instances *= 10;
+    }
+}
+
+static void WriteJson(std::ostream& out, const BenchmarkOptions& options, const BenchmarkResult& result)
+{
+    out << "{\n";
+    out << "  \"mode\": \"" << result.mode << "\",\n";
+    out << "  \"device\": \"" << result.deviceName << "\",\n";
+    out << "  \"sync\": \"" << result.sync << "\",\n";
+    out << "  \"rendering\": \"" << result.rendering << "\",\n";
+    out << "  \"width\": " << options.width << ",\n";
+    out << "  \"height\": " << options.height << ",\n";
+    out << "  \"frames_in_flight\": " << options.framesInFlight << ",\n";
+    out << "  \"frames\": " << options.frames << ",\n";
+    out << "  \"record_every_frame\": " << (options.recordEveryFrame ? "true" : "false") << ",\n";
+    if (result.sweepName != "instance") {
+        out << "  \"instances\": " << options.instances << ",\n";
+        out << "  \"instances_per_draw\": " << options.instancesPerDraw << ",\n";
+    }
+    if (result.sweepName != "thread") {
+        out << "  \"threads\": " << options.threads << ",\n";
+    }
+    out << "  \"init_ms\": {\n";
+    for (size_t i = 0; i < result.initTimings.size(); ++i) {
+        out << "    \"" << result.initTimings[i].name << "\": " << result.initTimings[i].milliseconds
+            << (i + 1 < result.initTimings.size() ? ",\n" : "\n");
+    }
+    out << "  },\n";
+    out << "  \"init_wall_ms\": " << result.initMilliseconds << ",\n";
+    if (!result.sweep.empty()) {
+        out << "  \"" << result.sweepName << "_sweep\": [\n";
+        for (size_t i = 0; i < result.sweep.size(); ++i) {
+            const SweepPoint& point = result.sweep[i];
+            out << "    { \"instances\": " << point.instances
+                << ", \"threads\": " << point.threads
+                << ", \"draws\": " << point.draws
+                << ", \"frames_per_second\": " << point.framesPerSecond
+                << ", \"cpu_frame_ms_mean\": " << point.cpuFrameMean
+                << ", \"cpu_frame_ms_p95\": " << point.cpuFrameP95
+                << ", \"record_ms_mean\": " << point.recordMean
+                << ", \"submit_ms_mean\": " << point.submitMean
+                << ", \"gpu_render_pass_ms_mean\": " << point.gpuRenderPassMean
+                << ", \"frames_recorded\": " << point.recording.framesRecorded
+                << ", \"frames_reused\": " << point.recording.framesReused
+                << ", \"image_misses\": " << point.recording.imageMisses
+                << (i + 1 < result.sweep.size() ? " },\n" : " }\n");
+        }
+        out << "  ]\n}\n";
+        return;
+    }
+    out << "  \"elapsed_seconds\": " << result.elapsedSeconds << ",\n";
+    out << "  \"frames_per_second\": " << options.frames / result.elapsedSeconds << ",\n";
+    out << "  \"cpu_frame_ms\": { \"mean\": " << result.frameTimes.Mean()
+        << ", \"p50\": " << result.frameTimes.Percentile(50.0)
+        << ", \"p95\": " << result.frameTimes.Percentile(95.0)
+        << ", \"p99\": " << result.frameTimes.Percentile(99.0)
+        << ", \"max\": " << result.frameTimes.Max() << " },\n";
+    out << "  \"recording\": { \"frames_recorded\": " << result.recording.framesRecorded
+        << ", \"frames_reused\": " << result.recording.framesReused
+        << ", \"image_misses\": " << result.recording.imageMisses << " },\n";
+    out << "  \"stages\": ";
+    std::ostringstream stages;
+    result.profiler->WriteJson(stages);
+    // indent the nested object to match
+    std::string line;
+    std::istringstream lines(stages.str());
+    bool first = true;
+    while (std::getline(lines, line)) {
+        out << (first ? "" : "\n  ") << line;
+        first = false;
+    }
+    out << "\n}\n";
+}
+
+// One "metric,value" row per measurement, followed by the per-stage table.
+static void WriteCsv(std::ostream& out, const BenchmarkOptions& options, const BenchmarkResult& result)
+{
+    out << "metric,value\n";
+    out << "mode," << result.mode << "\n";
+    out << "device," << result.deviceName << "\n";
+    out << "sync," << result.sync << "\n";
+    out << "rendering," << result.rendering << "\n";
+    out << "width," << options.width << "\n";
+    out << "height," << options.height << "\n";
+    out << "frames_in_flight," << options.framesInFlight << "\n";
+    out << "frames," << options.frames << "\n";
+    out << "record_every_frame," << (options.recordEveryFrame ? "true" : "false") << "\n";
+    if (result.sweepName != "instance") {
+        out << "instances," << options.instances << "\n";
+        out << "instances_per_draw," << options.instancesPerDraw << "\n";
+    }
+    if (result.sweepName != "thread") {
+        out << "threads," << options.threads << "\n";
+    }
+    for (const auto& timing : result.initTimings) {
+        out << "init_ms." << timing.name << "," << timing.milliseconds << "\n";
+    }
+    out << "init_wall_ms," << result.initMilliseconds << "\n";
+    if (!result.sweep.empty()) {
+        out << "\n";
+        out << "instances,threads,draws,frames_per_second,cpu_frame_ms_mean,cpu_frame_ms_p95,record_ms_mean,submit_ms_mean,"
+            "gpu_render_pass_ms_mean,frames_recorded,frames_reused,image_misses\n";
+        for (const auto& point : result.sweep) {
+            out << point.instances << "," << point.threads << "," << point.draws << "," << point.framesPerSecond << "," << point.cpuFrameMean << ","
+                << point.cpuFrameP95 << "," << point.recordMean << "," << point.submitMean << ","
+                << point.gpuRenderPassMean << "," << point.recording.framesRecorded << ","
+                << point.recording.framesReused << "," << point.recording.imageMisses << "\n";
+        }
+        return;
+    }
+    out << "elapsed_seconds," << result.elapsedSeconds << "\n";
+    out << "frames_per_second," << options.frames / result.elapsedSeconds << "\n";
+    out << "cpu_frame_ms.mean," << result.frameTimes.Mean() << "\n";
+    out << "cpu_frame_ms.p50," << result.frameTimes.Percentile(50.0) << "\n";
+    out << "cpu_frame_ms.p95," << result.frameTimes.Percentile(95.0) << "\n";
+    out << "cpu_frame_ms.p99," << result.frameTimes.Percentile(99.0) << "\n";
+    out << "cpu_frame_ms.max," << result.frameTimes.Max() << "\n";
+    out << "recording.frames_recorded," << result.recording.framesRecorded << "\n";
+    out << "recording.frames_reused," << result.recording.framesReused << "\n";
+    out << "recording.image_misses," << result.recording.imageMisses << "\n";
+    out << "\n";
+    result.profiler->WriteCsv(out);
+}
+
+static void WriteResult(std::ostream& out, const BenchmarkOptions& options, const BenchmarkResult& result)
+{
+    if (options.csv) {
+        WriteCsv(out, options, result);
+    }
+    else {
+        WriteJson(out, options, result);
+    }
+}
+
+static bool ReportResult(const BenchmarkOptions& options, const BenchmarkResult& result)
+{
+    if (options.outputFile.empty()) {
+        WriteResult(std::cout, options, result);
+        return true;
+    }
+    std::ofstream out(options.outputFile);
+    if (!out) {
+        std::cerr << "Unable to open " << options.outputFile << " for writing.\n";
+        return false;
+    }
+    WriteResult(out, options, result);
+    return static_cast<bool>(out);
+}
+
+static std::shared_ptr<VulkanContext> CreateContext(const BenchmarkOptions& options)
+{
+    std::shared_ptr<VulkanContext> context = std::make_shared<VulkanContext>();
+    if (!options.device.empty()) {
+        context->SetDeviceOverride(options.device);
+    }
+    context->SetTimelineSemaphoresRequested(options.timeline);
+    context->SetDynamicRenderingRequested(options.dynamicRendering);
+    return context;
+}
+
+static bool RunHeadless(const BenchmarkOptions& options)
+{
+    BenchmarkResult result(options.frames);
+    result.mode = "headless";
+    auto start = std::chrono::steady_clock::now();
+    VulkanOffscreenRenderer renderer(options.width, options.height, false,
+        VulkanOffscreenRenderer::DEFAULT_IMAGE_COUNT, CreateContext(options));
+    auto end = std::chrono::steady_clock::now();
+    result.initMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+    renderer.SetFramesInFlight(options.framesInFlight);
+    RunInstances(options, renderer, [&] { renderer.RenderFrame(); }, result);
+    return ReportResult(options, result);
+}
+
+#ifdef BENCHMARK_HAS_WINDOWED
+static bool RunWindowed(const BenchmarkOptions& options)
+{
+    wxApp::SetInstance(new wxApp());
+    wxInitializer initializer;
+    if (!initializer.IsOk()) {
+        std::cerr << "Unable to initialize wxWidgets.\n";
+        return false;
+    }
+    BenchmarkResult result(options.frames);
+    result.mode = "windowed";
+    bool ok = true;
+    wxFrame* frame = new wxFrame(nullptr, wxID_ANY, "VulkanBenchmark");
+    {
+        auto start = std::chrono::steady_clock::now();
+        VulkanCanvas* canvas = new VulkanCanvas(frame, wxID_ANY, wxDefaultPosition,
+            wxSize(options.width, options.height), 0, "VulkanCanvasName", CreateContext(options));
+        auto end = std::chrono::steady_clock::now();
+        result.initMilliseconds = std::chrono::duration<double, std::milli>(end - start).count();
+        canvas->SetRenderOnPaint(false);
+        canvas->SetFramesInFlight(options.framesInFlight);
+        frame->Fit();
+        frame->Show(true);
+        auto renderOne = [&] {
+            if (!canvas->RenderFrame()) {
+                throw std::runtime_error("Rendering failed.");
+            }
+            // keep the window responsive; the compositor may throttle an unresponsive window
+            wxYield();
+        };
+        RunInstances(options, *canvas, renderOne, result);
+        ok = ReportResult(options, result);
+    }
+    frame->Destroy();
+    return ok;
+}
+#endif
+
+int main(int argc, char* argv[])
+{
+    BenchmarkOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 2;
+    }
+    try {
+        if (options.windowed) {
+#ifdef BENCHMARK_HAS_WINDOWED
+            return RunWindowed(options) ? 0 : 1;
+#else
+            std::cerr << "Windowed benchmarks are not supported on this platform.\n";
+            return 2;
+#endif
+        }
+        return RunHeadless(options) ? 0 : 1;
+    }
+    catch (const VulkanException& ve) {
+        std::cerr << ve.what() << "\n" << ve.GetStatus() << "\n";
+    }
+    catch (const std::exception& err) {
+        std::cerr << "Error encountered running the benchmark:\n" << err.what() << "\n";
+    }
+    return 1;
+}
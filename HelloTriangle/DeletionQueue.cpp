@@ -0,0 +1,59 @@
+#include "DeletionQueue.h"
+#include "VulkanContext.h"
+#include <algorithm>
+#include <iterator>
+
+DeletionQueue::DeletionQueue()
+    : m_context(nullptr)
+{
+}
+
+
+DeletionQueue::~DeletionQueue() noexcept
+{
+    Flush();
+}
+
+void DeletionQueue::Create(const VulkanContext& context) noexcept
+{
+    m_context = &context;
+}
+
+void DeletionQueue::Retire(const std::vector<SubmitPoint>& points, Deleter deleter)
+{
+    Retired retired;
+    std::copy_if(points.begin(), points.end(), std::back_inserter(retired.points),
+        [](const SubmitPoint& point) { return !point.IsNull(); });
+    if (retired.points.empty()) {
+        deleter();
+        return;
+    }
+    retired.deleter = deleter;
+    m_retired.push_back(retired);
+}
+
+void DeletionQueue::Collect() noexcept
+{
+    for (auto& retired : m_retired) {
+        retired.points.erase(std::remove_if(retired.points.begin(), retired.points.end(),
+            [this](const SubmitPoint& point) { return m_context->IsComplete(point); }),
+            retired.points.end());
+    }
+    // deleters run in the order their objects were retired, so an old swapchain goes before a newer one
+    auto done = std::stable_partition(m_retired.begin(), m_retired.end(),
+        [](const Retired& retired) { return retired.points.empty(); });
+    for (auto retired = m_retired.begin(); retired != done; ++retired) {
+        retired->deleter();
+    }
+    m_retired.erase(m_retired.begin(), done);
+}
+
+void DeletionQueue::Flush() noexcept
+{
+    for (auto& retired : m_retired) {
+        // a failed wait means the device is lost, and then nothing is using the object any more
+        m_context->Wait(retired.points);
+        retired.deleter();
+    }
+    m_retired.clear();
+}
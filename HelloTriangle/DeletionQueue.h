@@ -0,0 +1,44 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include "QueueSubmission.h"
+
+class VulkanContext;
+
+// Destroys objects that submitted work may still be using once that work has finished, rather
+// than waiting for the device or the frames in flight first. Each retired object is tagged with
+// the submit points that may use it, usually those of the frames in flight, and destroyed by
+// Collect once the GPU has passed all of them.
+//
+// A frame slot's fence is reset and reused for the slot's next submission, but only after the
+// submission it marked has completed, so a reused fence can only delay a deleter. Collect
+// forgets each point as soon as it is seen complete, so calling it right after waiting for a
+// frame slot frees everything within one round of the slots.
+class DeletionQueue
+{
+public:
+    typedef std::function<void()> Deleter;
+
+    DeletionQueue();
+    virtual ~DeletionQueue() noexcept;
+
+    void Create(const VulkanContext& context) noexcept;
+    void Retire(const std::vector<SubmitPoint>& points, Deleter deleter);
+    // Forgets the points that are complete and destroys the objects that have none left. A point's
+    // fence must not be destroyed while the queue still holds it, so whoever destroys fences that
+    // retired objects may be waiting on calls this once they have signaled.
+    void Collect() noexcept;
+    // Waits for the points that are left, then runs every deleter; for teardown, and for before
+    // the fences that the points use are destroyed.
+    void Flush() noexcept;
+    size_t GetPendingCount() const noexcept { return m_retired.size(); }
+
+private:
+    struct Retired {
+        std::vector<SubmitPoint> points;
+        Deleter deleter;
+    };
+
+    const VulkanContext* m_context;
+    std::vector<Retired> m_retired;
+};
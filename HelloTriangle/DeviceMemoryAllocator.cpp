@@ -0,0 +1,318 @@
+#include "DeviceMemoryAllocator.h"
+#include "VulkanException.h"
+#include <algorithm>
+#include <iterator>
+
+// One VkDeviceMemory allocation and the ranges within it that are not in use
+class MemoryBlock
+{
+public:
+    MemoryBlock(VkDeviceMemory blockMemory, VkDeviceSize blockSize, uint32_t blockMemoryType,
+        DeviceMemoryAllocator::ResourceKind blockKind, bool dedicatedBlock)
+        : memory(blockMemory), size(blockSize), memoryType(blockMemoryType), kind(blockKind),
+        dedicated(dedicatedBlock),
+        mappedData(nullptr), bytesInUse(0), allocationCount(0)
+    {
+        freeRanges[0] = size;
+    }
+
+    // Best fit: the smallest free range that can hold the aligned request
+    bool TryAllocate(VkDeviceSize requestSize, VkDeviceSize alignment, VkDeviceSize& offset)
+    {
+        auto best = freeRanges.end();
+        VkDeviceSize bestOffset = 0;
+        for (auto iter = freeRanges.begin(); iter != freeRanges.end(); ++iter) {
+            VkDeviceSize alignedOffset = (iter->first + alignment - 1) / alignment * alignment;
+            VkDeviceSize end = iter->first + iter->second;
+            if (alignedOffset + requestSize <= end &&
+                (best == freeRanges.end() || iter->second < best->second)) {
+                best = iter;
+                bestOffset = alignedOffset;
+            }
+        }
+        if (best == freeRanges.end()) {
+            return false;
+        }
+        VkDeviceSize rangeStart = best->first;
+        VkDeviceSize rangeEnd = best->first + best->second;
+        freeRanges.erase(best);
+        // the alignment padding in front and the unused tail both stay free
+        if (bestOffset > rangeStart) {
+            freeRanges[rangeStart] = bestOffset - rangeStart;
+        }
+        if (bestOffset + requestSize < rangeEnd) {
+            freeRanges[bestOffset + requestSize] = rangeEnd - (bestOffset + requestSize);
+        }
+        offset = bestOffset;
+        bytesInUse += requestSize;
+        ++allocationCount;
+        return true;
+    }
+
+    void Free(VkDeviceSize offset, VkDeviceSize rangeSize)
+    {
+        auto inserted = freeRanges.insert({ offset, rangeSize }).first;
+        auto next = std::next(inserted);
+        if (next != freeRanges.end() && inserted->first + inserted->second == next->first) {
+            inserted->second += next->second;
+            freeRanges.erase(next);
+        }
+        if (inserted != freeRanges.begin()) {
+            auto previous = std::prev(inserted);
+            if (previous->first + previous->second == inserted->first) {
+                previous->second += inserted->second;
+                freeRanges.erase(inserted);
+            }
+        }
+        bytesInUse -= rangeSize;
+        --allocationCount;
+    }
+
+    bool IsEmpty() const noexcept { return allocationCount == 0; }
+
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t memoryType;
+    DeviceMemoryAllocator::ResourceKind kind;
+    bool dedicated;
+    void* mappedData;
+    VkDeviceSize bytesInUse;
+    uint32_t allocationCount;
+    // offset -> size
+    std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+};
+
+DeviceMemoryAllocator::DeviceMemoryAllocator(VkDeviceSize blockSize)
+    : m_device(VK_NULL_HANDLE), m_blockSize(blockSize), m_memoryProperties({}), m_maxAllocationCount(0)
+{
+}
+
+
+DeviceMemoryAllocator::~DeviceMemoryAllocator() noexcept
+{
+    Destroy();
+}
+
+void DeviceMemoryAllocator::Create(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+    m_device = device;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    m_maxAllocationCount = properties.limits.maxMemoryAllocationCount;
+}
+
+void DeviceMemoryAllocator::Destroy() noexcept
+{
+    for (auto& block : m_blocks) {
+        if (block->mappedData != nullptr) {
+            vkUnmapMemory(m_device, block->memory);
+        }
+        vkFreeMemory(m_device, block->memory, nullptr);
+    }
+    m_blocks.clear();
+}
+
+uint32_t DeviceMemoryAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred) const
+{
+    VkMemoryPropertyFlags wanted[] = { required | preferred, required };
+    for (auto properties : wanted) {
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) &&
+                (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+    }
+    throw std::runtime_error("Failed to find a suitable memory type.");
+}
+
+VkMemoryAllocateInfo DeviceMemoryAllocator::CreateMemoryAllocateInfo(VkDeviceSize size,
+    uint32_t memoryType) const noexcept
+{
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+    return allocInfo;
+}
+
+MemoryBlock* DeviceMemoryAllocator::CreateBlock(VkDeviceSize size, uint32_t memoryType,
+    ResourceKind kind, bool dedicated)
+{
+    if (m_blocks.size() >= m_maxAllocationCount) {
+        throw VulkanException(VK_ERROR_TOO_MANY_OBJECTS,
+            "The device memory allocation limit has been reached:");
+    }
+    VkMemoryAllocateInfo allocInfo = CreateMemoryAllocateInfo(size, memoryType);
+    VkDeviceMemory memory;
+    VkResult result = vkAllocateMemory(m_device, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to allocate a device memory block:");
+    }
+    std::unique_ptr<MemoryBlock> block(new MemoryBlock(memory, size, memoryType, kind, dedicated));
+    if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        // mapped once for the whole block; allocations point into it
+        result = vkMapMemory(m_device, memory, 0, VK_WHOLE_SIZE, 0, &block->mappedData);
+        if (result != VK_SUCCESS) {
+            vkFreeMemory(m_device, memory, nullptr);
+            throw VulkanException(result, "Failed to map a device memory block:");
+        }
+    }
+    m_blocks.push_back(std::move(block));
+    return m_blocks.back().get();
+}
+
+void DeviceMemoryAllocator::DestroyBlock(MemoryBlock* block) noexcept
+{
+    auto iter = std::find_if(m_blocks.begin(), m_blocks.end(),
+        [block](const std::unique_ptr<MemoryBlock>& candidate) { return candidate.get() == block; });
+    if (iter == m_blocks.end()) {
+        return;
+    }
+    if (block->mappedData != nullptr) {
+        vkUnmapMemory(m_device, block->memory);
+    }
+    vkFreeMemory(m_device, block->memory, nullptr);
+    m_blocks.erase(iter);
+}
+
+MemoryAllocation DeviceMemoryAllocator::Allocate(const VkMemoryRequirements& requirements,
+    ResourceKind kind, VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred)
+{
+    uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, required, preferred);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+    MemoryBlock* block = nullptr;
+    VkDeviceSize offset = 0;
+    if (requirements.size > m_blockSize / 2) {
+        block = CreateBlock(requirements.size, memoryType, kind, true);
+        block->TryAllocate(requirements.size, alignment, offset);
+    }
+    else {
+        for (auto& candidate : m_blocks) {
+            if (!candidate->dedicated && candidate->memoryType == memoryType && candidate->kind == kind &&
+                candidate->TryAllocate(requirements.size, alignment, offset)) {
+                block = candidate.get();
+                break;
+            }
+        }
+        if (block == nullptr) {
+            // small heaps (such as a 256 MiB host-visible device-local heap) get smaller blocks
+            VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[
+                m_memoryProperties.memoryTypes[memoryType].heapIndex].size;
+            VkDeviceSize blockSize = std::max(std::min(m_blockSize, heapSize / 8), requirements.size);
+            block = CreateBlock(blockSize, memoryType, kind, false);
+            block->TryAllocate(requirements.size, alignment, offset);
+        }
+    }
+
+    MemoryAllocation allocation;
+    allocation.memory = block->memory;
+    allocation.offset = offset;
+    allocation.size = requirements.size;
+    allocation.mappedData = block->mappedData == nullptr ? nullptr :
+        static_cast<char*>(block->mappedData) + offset;
+    allocation.memoryType = memoryType;
+    allocation.block = block;
+    return allocation;
+}
+
+void DeviceMemoryAllocator::Free(MemoryAllocation& allocation) noexcept
+{
+    MemoryBlock* block = allocation.block;
+    if (block == nullptr) {
+        return;
+    }
+    block->Free(allocation.offset, allocation.size);
+    allocation = MemoryAllocation();
+    if (!block->IsEmpty()) {
+        return;
+    }
+    // keep one empty block of each type so that a free followed by an allocate does not
+    // go back to the driver
+    bool otherEmptyBlock = std::any_of(m_blocks.begin(), m_blocks.end(),
+        [block](const std::unique_ptr<MemoryBlock>& candidate) {
+            return candidate.get() != block && candidate->IsEmpty() && !candidate->dedicated &&
+                candidate->memoryType == block->memoryType && candidate->kind == block->kind;
+        });
+    if (block->dedicated || otherEmptyBlock) {
+        DestroyBlock(block);
+    }
+}
+
+VkBufferCreateInfo DeviceMemoryAllocator::CreateBufferCreateInfo(VkDeviceSize size,
+    VkBufferUsageFlags usage) const noexcept
+{
+    VkBufferCreateInfo bufferInfo = {};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    return bufferInfo;
+}
+
+AllocatedBuffer DeviceMemoryAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+    VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred)
+{
+    AllocatedBuffer buffer;
+    VkBufferCreateInfo bufferInfo = CreateBufferCreateInfo(size, usage);
+    VkResult result = vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer.buffer);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to create a buffer:");
+    }
+    try {
+        VkMemoryRequirements requirements;
+        vkGetBufferMemoryRequirements(m_device, buffer.buffer, &requirements);
+        buffer.allocation = Allocate(requirements, ResourceKind::Linear, required, preferred);
+        result = vkBindBufferMemory(m_device, buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to bind memory to a buffer:");
+        }
+    }
+    catch (...) {
+        DestroyBuffer(buffer);
+        throw;
+    }
+    return buffer;
+}
+
+void DeviceMemoryAllocator::DestroyBuffer(AllocatedBuffer& buffer) noexcept
+{
+    if (buffer.buffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(m_device, buffer.buffer, nullptr);
+    }
+    Free(buffer.allocation);
+    buffer = AllocatedBuffer();
+}
+
+MemoryAllocation DeviceMemoryAllocator::AllocateImageMemory(VkImage image, VkMemoryPropertyFlags required,
+    VkMemoryPropertyFlags preferred)
+{
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_device, image, &requirements);
+    MemoryAllocation allocation = Allocate(requirements, ResourceKind::Optimal, required, preferred);
+    VkResult result = vkBindImageMemory(m_device, image, allocation.memory, allocation.offset);
+    if (result != VK_SUCCESS) {
+        Free(allocation);
+        throw VulkanException(result, "Failed to bind memory to an image:");
+    }
+    return allocation;
+}
+
+MemoryStatistics DeviceMemoryAllocator::GetStatistics() const noexcept
+{
+    MemoryStatistics statistics;
+    statistics.blockCount = m_blocks.size();
+    for (const auto& block : m_blocks) {
+        statistics.allocationCount += block->allocationCount;
+        statistics.bytesReserved += block->size;
+        statistics.bytesInUse += block->bytesInUse;
+        statistics.freeRangeCount += block->freeRanges.size();
+        for (const auto& range : block->freeRanges) {
+            statistics.largestFreeRange = std::max(statistics.largestFreeRange, range.second);
+        }
+    }
+    return statistics;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+class MemoryBlock;
+
+// A range of device memory handed out by DeviceMemoryAllocator. mappedData is non-null
+// for host-visible memory, which stays mapped for the lifetime of the allocation.
+struct MemoryAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* mappedData = nullptr;
+    uint32_t memoryType = 0;
+    MemoryBlock* block = nullptr;
+};
+
+// A buffer together with the memory bound to it
+struct AllocatedBuffer {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    MemoryAllocation allocation;
+};
+
+struct MemoryStatistics {
+    size_t blockCount = 0;
+    size_t allocationCount = 0;
+    // device memory obtained with vkAllocateMemory
+    VkDeviceSize bytesReserved = 0;
+    // memory handed out to resources, excluding alignment padding
+    VkDeviceSize bytesInUse = 0;
+    size_t freeRangeCount = 0;
+    VkDeviceSize largestFreeRange = 0;
+
+    // 0 when all free memory is in one range per block; approaches 1 as it splinters
+    double Fragmentation() const {
+        VkDeviceSize bytesFree = bytesReserved - bytesInUse;
+        return bytesFree == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeRange) / bytesFree;
+    }
+};
+
+// Sub-allocates buffers and images from a small number of large VkDeviceMemory blocks
+// instead of calling vkAllocateMemory for every resource. Each block serves one memory type
+// and either linear (buffers) or optimal-tiling (images) resources, so bufferImageGranularity
+// never has to be considered within a block. Free space in a block is kept as a list of
+// ranges ordered by offset; allocations take the best fitting range and freed ranges are
+// merged with their neighbours. Requests larger than half a block get a block of their own.
+class DeviceMemoryAllocator
+{
+public:
+    static const VkDeviceSize DEFAULT_BLOCK_SIZE = 64 * 1024 * 1024;
+
+    enum class ResourceKind {
+        Linear,
+        Optimal
+    };
+
+    DeviceMemoryAllocator(VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+    virtual ~DeviceMemoryAllocator() noexcept;
+
+    void Create(VkDevice device, VkPhysicalDevice physicalDevice);
+    void Destroy() noexcept;
+
+    // The memory type must have all of the required properties; one that also has the
+    // preferred properties is chosen if there is one.
+    MemoryAllocation Allocate(const VkMemoryRequirements& requirements, ResourceKind kind,
+        VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void Free(MemoryAllocation& allocation) noexcept;
+
+    AllocatedBuffer CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
+        VkMemoryPropertyFlags required, VkMemoryPropertyFlags preferred = 0);
+    void DestroyBuffer(AllocatedBuffer& buffer) noexcept;
+    // Allocates memory for an image and binds it.
+    MemoryAllocation AllocateImageMemory(VkImage image, VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred = 0);
+
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags required,
+        VkMemoryPropertyFlags preferred = 0) const;
+    MemoryStatistics GetStatistics() const noexcept;
+
+private:
+    VkBufferCreateInfo CreateBufferCreateInfo(VkDeviceSize size, VkBufferUsageFlags usage) const noexcept;
+    VkMemoryAllocateInfo CreateMemoryAllocateInfo(VkDeviceSize size, uint32_t memoryType) const noexcept;
+    MemoryBlock* CreateBlock(VkDeviceSize size, uint32_t memoryType, ResourceKind kind, bool dedicated);
+    void DestroyBlock(MemoryBlock* block) noexcept;
+
+    VkDevice m_device;
+    VkDeviceSize m_blockSize;
+    VkPhysicalDeviceMemoryProperties m_memoryProperties;
+    uint32_t m_maxAllocationCount;
+    std::vector<std::unique_ptr<MemoryBlock>> m_blocks;
+};
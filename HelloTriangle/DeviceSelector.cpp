@@ -0,0 +1,195 @@
+#include "DeviceSelector.h"
+#include "VulkanException.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+
+const char* const DeviceSelector::OVERRIDE_VARIABLE = "VULKAN_DEVICE";
+
+DeviceSelector::DeviceSelector()
+{
+}
+
+
+DeviceSelector::~DeviceSelector() noexcept
+{
+}
+
+void DeviceSelector::Probe(VkInstance instance, PFN_vkGetPhysicalDeviceProperties2 getProperties2)
+{
+    uint32_t deviceCount = 0;
+    VkResult result = vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Unable to retrieve the count of physical devices:");
+    }
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    result = vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
+    if (result != VK_SUCCESS && result != VK_INCOMPLETE) {
+        throw VulkanException(result, "Unable to retrieve the physical devices:");
+    }
+    m_devices.clear();
+    for (uint32_t i = 0; i < deviceCount; ++i) {
+        m_devices.push_back(ProbeDevice(devices[i], i, getProperties2));
+    }
+}
+
+PhysicalDeviceInfo DeviceSelector::ProbeDevice(VkPhysicalDevice device, uint32_t index,
+    PFN_vkGetPhysicalDeviceProperties2 getProperties2) const
+{
+    PhysicalDeviceInfo info;
+    info.device = device;
+    info.index = index;
+    vkGetPhysicalDeviceProperties(device, &info.properties);
+    vkGetPhysicalDeviceMemoryProperties(device, &info.memoryProperties);
+
+    uint32_t queueFamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
+    info.queueFamilies.resize(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, info.queueFamilies.data());
+
+    uint32_t extensionCount = 0;
+    VkResult result = vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Cannot retrieve count of properties for a physical device:");
+    }
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    result = vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Cannot retrieve properties for a physical device:");
+    }
+    for (const auto& extension : extensions) {
+        info.extensions.insert(extension.extensionName);
+    }
+
+    for (uint32_t heap = 0; heap < info.memoryProperties.memoryHeapCount; ++heap) {
+        if (info.memoryProperties.memoryHeaps[heap].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            info.deviceLocalBytes += info.memoryProperties.memoryHeaps[heap].size;
+        }
+    }
+
+    info.uuid = GetDeviceUuid(info, getProperties2);
+    info.score = Score(info);
+    return info;
+}
+
+std::string DeviceSelector::GetDeviceUuid(const PhysicalDeviceInfo& info,
+    PFN_vkGetPhysicalDeviceProperties2 getProperties2)
+{
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0');
+    // VkPhysicalDeviceIDProperties is core in Vulkan 1.1
+    if (getProperties2 != nullptr && info.properties.apiVersion >= VK_API_VERSION_1_1) {
+        VkPhysicalDeviceIDProperties idProperties = {};
+        idProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ID_PROPERTIES;
+        VkPhysicalDeviceProperties2 properties = {};
+        properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties.pNext = &idProperties;
+        getProperties2(info.device, &properties);
+        const uint8_t* begin = idProperties.deviceUUID;
+        const uint8_t* end = begin + VK_UUID_SIZE;
+        // a driver that ignored the structure leaves it zeroed
+        if (std::any_of(begin, end, [](uint8_t byte) { return byte != 0; })) {
+            for (const uint8_t* byte = begin; byte != end; ++byte) {
+                ss << std::setw(2) << static_cast<unsigned>(*byte);
+            }
+            return ss.str();
+        }
+    }
+    ss << std::setw(4) << info.properties.vendorID << ':' << std::setw(4) << info.properties.deviceID << ':'
+        << std::dec << info.index;
+    return ss.str();
+}
+
+const PhysicalDeviceInfo& DeviceSelector::GetInfo(VkPhysicalDevice device) const
+{
+    for (const auto& info : m_devices) {
+        if (info.device == device) {
+            return info;
+        }
+    }
+    throw std::runtime_error("Programming Error:\nThe physical device was not probed by the DeviceSelector.");
+}
+
+int64_t DeviceSelector::Score(const PhysicalDeviceInfo& info) noexcept
+{
+    // each term is smaller than one step of the term before it
+    int64_t typeScore = 0;
+    switch (info.properties.deviceType) {
+    case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:
+        typeScore = 3;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU:
+        typeScore = 2;
+        break;
+    case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:
+        typeScore = 1;
+        break;
+    default:
+        // CPU implementations such as lavapipe and SwiftShader, and anything unknown
+        break;
+    }
+    int64_t score = typeScore * 1000000000;
+    // MiB of video memory; integrated GPUs report shared system memory, but they have lost on type already
+    score += static_cast<int64_t>(std::min<VkDeviceSize>(info.deviceLocalBytes >> 20, 999999)) * 1000;
+
+    bool transferFamily = false;
+    bool computeFamily = false;
+    for (const auto& family : info.queueFamilies) {
+        if (family.queueCount == 0 || family.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            continue;
+        }
+        if (family.queueFlags & VK_QUEUE_COMPUTE_BIT) {
+            computeFamily = true;
+        }
+        else if (family.queueFlags & VK_QUEUE_TRANSFER_BIT) {
+            transferFamily = true;
+        }
+    }
+    // uploads go to a dedicated transfer family when there is one; see StagingUploader
+    score += transferFamily ? 500 : 0;
+    score += computeFamily ? 250 : 0;
+    score += std::min<uint32_t>(info.properties.limits.maxImageDimension2D / 128, 249);
+    return score;
+}
+
+VkPhysicalDevice DeviceSelector::Select(const std::function<bool(const PhysicalDeviceInfo&)>& isSuitable,
+    const std::string& deviceOverride) const
+{
+    if (!deviceOverride.empty()) {
+        for (const auto& info : m_devices) {
+            if (deviceOverride == std::to_string(info.index) || deviceOverride == info.uuid) {
+                if (!isSuitable(info)) {
+                    throw std::runtime_error("The requested Vulkan device, " + std::string(info.properties.deviceName) +
+                        ", does not have the required extensions and swap chain support.");
+                }
+                return info.device;
+            }
+        }
+        throw std::runtime_error("No Vulkan device has the index or UUID \"" + deviceOverride + "\".");
+    }
+    const PhysicalDeviceInfo* best = nullptr;
+    for (const auto& info : m_devices) {
+        if ((best == nullptr || info.score > best->score) && isSuitable(info)) {
+            best = &info;
+        }
+    }
+    return best == nullptr ? VK_NULL_HANDLE : best->device;
+}
+
+std::string DeviceSelector::GetEnvironmentOverride()
+{
+#ifdef _WIN32
+    char* value = nullptr;
+    size_t length = 0;
+    if (_dupenv_s(&value, &length, OVERRIDE_VARIABLE) != 0 || value == nullptr) {
+        return std::string();
+    }
+    std::string result(value);
+    free(value);
+    return result;
+#else
+    const char* value = std::getenv(OVERRIDE_VARIABLE);
+    return value == nullptr ? std::string() : std::string(value);
+#endif
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <set>
+#include <string>
+#include <vector>
+
+// What DeviceSelector learned about a physical device when the instance was created
+struct PhysicalDeviceInfo {
+    VkPhysicalDevice device = VK_NULL_HANDLE;
+    // position in vkEnumeratePhysicalDevices order
+    uint32_t index = 0;
+    VkPhysicalDeviceProperties properties = {};
+    VkPhysicalDeviceMemoryProperties memoryProperties = {};
+    std::vector<VkQueueFamilyProperties> queueFamilies;
+    std::set<std::string> extensions;
+    // total size of the device-local heaps
+    VkDeviceSize deviceLocalBytes = 0;
+    // VkPhysicalDeviceIDProperties::deviceUUID as 32 hex digits, which stays the same across runs
+    // and tells identical GPUs apart. Where the device UUID cannot be queried, it is vendor ID,
+    // device ID and index instead, such as "10de:2684:0".
+    std::string uuid;
+    int64_t score = 0;
+};
+
+// Enumerates the physical devices of an instance once, caching their properties, queue families and
+// extensions so that device selection and later queries do not repeat the enumeration, and picks the
+// device to render with.
+class DeviceSelector
+{
+public:
+    // the name of the environment variable that overrides device selection
+    static const char* const OVERRIDE_VARIABLE;
+
+    DeviceSelector();
+    virtual ~DeviceSelector() noexcept;
+
+    // getProperties2 is vkGetPhysicalDeviceProperties2 or its KHR alias, or nullptr if the
+    // instance has neither.
+    void Probe(VkInstance instance, PFN_vkGetPhysicalDeviceProperties2 getProperties2);
+    const std::vector<PhysicalDeviceInfo>& GetDevices() const noexcept { return m_devices; }
+    // Throws if device was not among the probed devices.
+    const PhysicalDeviceInfo& GetInfo(VkPhysicalDevice device) const;
+
+    // With an empty deviceOverride, returns the highest scoring device for which isSuitable
+    // returns true, or VK_NULL_HANDLE if there is none. Otherwise returns the device whose index
+    // or UUID is deviceOverride, and throws if there is no such device or it is not suitable.
+    VkPhysicalDevice Select(const std::function<bool(const PhysicalDeviceInfo&)>& isSuitable,
+        const std::string& deviceOverride) const;
+
+    // Prefers discrete over integrated over virtual over software devices, then more video
+    // memory, then dedicated transfer and compute queue families, then larger limits.
+    static int64_t Score(const PhysicalDeviceInfo& info) noexcept;
+    // the value of OVERRIDE_VARIABLE, or an empty string if it is not set
+    static std::string GetEnvironmentOverride();
+
+private:
+    PhysicalDeviceInfo ProbeDevice(VkPhysicalDevice device, uint32_t index,
+        PFN_vkGetPhysicalDeviceProperties2 getProperties2) const;
+    static std::string GetDeviceUuid(const PhysicalDeviceInfo& info,
+        PFN_vkGetPhysicalDeviceProperties2 getProperties2);
+
+    std::vector<PhysicalDeviceInfo> m_devices;
+};
@@ -0,0 +1,65 @@
+#include "FrameArena.h"
+#include <algorithm>
+#include <stdexcept>
+
+FrameArena::FrameArena()
+    : m_allocator(nullptr), m_minAlignment(1), m_frameStart(0), m_frameUsed(0)
+{
+}
+
+
+FrameArena::~FrameArena() noexcept
+{
+    Destroy();
+}
+
+void FrameArena::Create(DeviceMemoryAllocator& allocator, uint32_t frameCount, VkDeviceSize bytesPerFrame,
+    VkBufferUsageFlags usage, VkDeviceSize minAlignment)
+{
+    Destroy();
+    m_allocator = &allocator;
+    m_minAlignment = std::max<VkDeviceSize>(minAlignment, 1);
+    // each frame's region starts on an aligned offset
+    bytesPerFrame = (bytesPerFrame + m_minAlignment - 1) / m_minAlignment * m_minAlignment;
+    // device-local host-visible memory, where it exists, saves the GPU reading across the bus
+    m_buffer = allocator.CreateBuffer(bytesPerFrame * frameCount, usage,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_statistics = FrameArenaStatistics();
+    m_statistics.bytesPerFrame = bytesPerFrame;
+    m_frameStart = 0;
+    m_frameUsed = 0;
+}
+
+void FrameArena::Destroy() noexcept
+{
+    if (m_allocator != nullptr) {
+        m_allocator->DestroyBuffer(m_buffer);
+        m_allocator = nullptr;
+    }
+}
+
+void FrameArena::BeginFrame(uint32_t frameIndex) noexcept
+{
+    m_statistics.lastFrameBytes = m_frameUsed;
+    m_frameStart = frameIndex * m_statistics.bytesPerFrame;
+    m_frameUsed = 0;
+}
+
+ArenaAllocation FrameArena::Allocate(VkDeviceSize size, VkDeviceSize alignment)
+{
+    alignment = std::max(alignment, m_minAlignment);
+    VkDeviceSize offset = (m_frameUsed + alignment - 1) / alignment * alignment;
+    if (offset + size > m_statistics.bytesPerFrame) {
+        ++m_statistics.overflowCount;
+        throw std::runtime_error("Programming Error:\nThe per-frame arena is too small for this frame's data.");
+    }
+    m_frameUsed = offset + size;
+    m_statistics.peakFrameBytes = std::max(m_statistics.peakFrameBytes, m_frameUsed);
+
+    ArenaAllocation allocation;
+    allocation.buffer = m_buffer.buffer;
+    allocation.offset = m_frameStart + offset;
+    allocation.data = static_cast<char*>(m_buffer.allocation.mappedData) + m_frameStart + offset;
+    return allocation;
+}
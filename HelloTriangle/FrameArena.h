@@ -0,0 +1,44 @@
+#pragma once
+#include "DeviceMemoryAllocator.h"
+
+// Space handed out by FrameArena; valid until the same frame slot comes round again
+struct ArenaAllocation {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    void* data = nullptr;
+};
+
+struct FrameArenaStatistics {
+    VkDeviceSize bytesPerFrame = 0;
+    VkDeviceSize lastFrameBytes = 0;
+    VkDeviceSize peakFrameBytes = 0;
+    uint64_t overflowCount = 0;
+};
+
+// Linear allocator for data that lives for a single frame, such as uniforms. One persistently
+// mapped, host-coherent buffer is divided into a region per frame slot; allocating bumps an
+// offset and BeginFrame rewinds it, which is safe once the slot's fence has signaled.
+class FrameArena
+{
+public:
+    static const VkDeviceSize DEFAULT_BYTES_PER_FRAME = 256 * 1024;
+
+    FrameArena();
+    virtual ~FrameArena() noexcept;
+
+    void Create(DeviceMemoryAllocator& allocator, uint32_t frameCount, VkDeviceSize bytesPerFrame,
+        VkBufferUsageFlags usage, VkDeviceSize minAlignment);
+    void Destroy() noexcept;
+    void BeginFrame(uint32_t frameIndex) noexcept;
+    ArenaAllocation Allocate(VkDeviceSize size, VkDeviceSize alignment = 1);
+    VkBuffer GetBuffer() const noexcept { return m_buffer.buffer; }
+    const FrameArenaStatistics& GetStatistics() const noexcept { return m_statistics; }
+
+private:
+    DeviceMemoryAllocator* m_allocator;
+    AllocatedBuffer m_buffer;
+    VkDeviceSize m_minAlignment;
+    VkDeviceSize m_frameStart;
+    VkDeviceSize m_frameUsed;
+    FrameArenaStatistics m_statistics;
+};
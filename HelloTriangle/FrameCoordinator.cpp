@@ -0,0 +1,181 @@
+#include "FrameCoordinator.h"
+#include "VulkanException.h"
+#include <algorithm>
+
+FrameCoordinator::FrameCoordinator(std::shared_ptr<VulkanContext> context, uint32_t framesInFlight)
+    : m_context(context), m_currentFrame(0)
+{
+    if (!m_context || !m_context->IsDeviceCreated()) {
+        throw std::runtime_error("Programming Error:\nA FrameCoordinator needs a context with a device.");
+    }
+    if (framesInFlight == 0) {
+        throw std::runtime_error("Programming Error:\nAt least one frame must be allowed in flight.");
+    }
+    m_frames.assign(framesInFlight, SubmitPoint());
+    if (m_context->UsesTimelineSemaphores()) {
+        return;
+    }
+    VkFenceCreateInfo fenceInfo = CreateFenceCreateInfo();
+    m_fences.assign(framesInFlight, VK_NULL_HANDLE);
+    for (auto& fence : m_fences) {
+        VkResult result = vkCreateFence(m_context->GetDevice(), &fenceInfo, nullptr, &fence);
+        if (result != VK_SUCCESS) {
+            for (auto created : m_fences) {
+                if (created != VK_NULL_HANDLE) {
+                    vkDestroyFence(m_context->GetDevice(), created, nullptr);
+                }
+            }
+            throw VulkanException(result, "Failed to create a coordinated frame fence:");
+        }
+    }
+}
+
+
+FrameCoordinator::~FrameCoordinator() noexcept
+{
+    WaitForFramesInFlight();
+    for (auto canvas : m_canvases) {
+        canvas->SetFrameCoordinator(nullptr);
+    }
+    for (auto fence : m_fences) {
+        vkDestroyFence(m_context->GetDevice(), fence, nullptr);
+    }
+}
+
+VkFenceCreateInfo FrameCoordinator::CreateFenceCreateInfo() const noexcept
+{
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    return fenceInfo;
+}
+
+VkPresentInfoKHR FrameCoordinator::CreatePresentInfoKHR() noexcept
+{
+    VkPresentInfoKHR presentInfo = {};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+
+    presentInfo.waitSemaphoreCount = static_cast<uint32_t>(m_presentWaits.size());
+    presentInfo.pWaitSemaphores = m_presentWaits.data();
+
+    presentInfo.swapchainCount = static_cast<uint32_t>(m_swapchains.size());
+    presentInfo.pSwapchains = m_swapchains.data();
+    presentInfo.pImageIndices = m_imageIndices.data();
+    // one result per swapchain, so that an out of date swapchain only affects its own canvas
+    presentInfo.pResults = m_presentResults.data();
+    return presentInfo;
+}
+
+void FrameCoordinator::AddCanvas(VulkanCanvas* canvas)
+{
+    if (canvas->GetContext() != m_context) {
+        throw std::runtime_error("Programming Error:\nA canvas added to a FrameCoordinator must share its context.");
+    }
+    if (std::find(m_canvases.begin(), m_canvases.end(), canvas) != m_canvases.end()) {
+        return;
+    }
+    if (!m_canvases.empty() && (canvas->GetGraphicsQueue() != m_canvases[0]->GetGraphicsQueue() ||
+        canvas->GetPresentQueue() != m_canvases[0]->GetPresentQueue())) {
+        throw std::runtime_error("The canvases cannot be submitted and presented on the same queues.");
+    }
+    canvas->SetFrameCoordinator(this);
+    m_canvases.push_back(canvas);
+}
+
+void FrameCoordinator::RemoveCanvas(VulkanCanvas* canvas) noexcept
+{
+    auto iter = std::find(m_canvases.begin(), m_canvases.end(), canvas);
+    if (iter == m_canvases.end()) {
+        return;
+    }
+    // the canvas's slots may have been submitted under any of the fences
+    WaitForFramesInFlight();
+    canvas->SetFrameCoordinator(nullptr);
+    m_canvases.erase(iter);
+}
+
+void FrameCoordinator::WaitForFramesInFlight() noexcept
+{
+    m_context->Wait(m_frames);
+}
+
+void FrameCoordinator::RenderFrame()
+{
+    if (m_canvases.empty()) {
+        return;
+    }
+    VkResult result = m_context->Wait(m_frames[m_currentFrame]);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to wait for a coordinated frame:");
+    }
+
+    m_acquired.clear();
+    m_canvasFrames.clear();
+    for (auto canvas : m_canvases) {
+        CanvasFrame canvasFrame;
+        if (canvas->AcquireFrame(canvasFrame)) {
+            m_acquired.push_back(canvas);
+            m_canvasFrames.push_back(std::move(canvasFrame));
+        }
+        else {
+            m_statistics.canvasesSkipped++;
+        }
+    }
+    if (m_acquired.empty()) {
+        return;
+    }
+
+    // a batch per canvas, as each waits on its own acquire; m_canvasFrames and m_timelineSubmits
+    // are not resized below, so the pointers the submit infos hold into them stay valid
+    VkQueue queue = m_acquired[0]->GetGraphicsQueue();
+    VkFence fence = m_fences.empty() ? VK_NULL_HANDLE : m_fences[m_currentFrame];
+    m_submitPoints.clear();
+    m_submitInfos.clear();
+    m_presentWaits.clear();
+    m_swapchains.clear();
+    m_imageIndices.clear();
+    for (const auto& canvasFrame : m_canvasFrames) {
+        // each batch signals a timeline value of its own; without timelines one fence covers them all
+        if (m_submitPoints.empty() || m_fences.empty()) {
+            m_submitPoints.push_back(m_context->BeginSubmit(queue, fence));
+        }
+        else {
+            SubmitPoint point = m_submitPoints[0];
+            m_submitPoints.push_back(point);
+        }
+        m_submitInfos.push_back(VulkanCanvas::CreateSubmitInfo(canvasFrame));
+        m_presentWaits.push_back(canvasFrame.renderFinishedSemaphore);
+        m_swapchains.push_back(canvasFrame.swapchain);
+        m_imageIndices.push_back(canvasFrame.imageIndex);
+    }
+    m_timelineSubmits.resize(m_submitInfos.size());
+    for (size_t i = 0; i < m_submitInfos.size(); i++) {
+        m_timelineSubmits[i].Apply(m_submitInfos[i], m_canvasFrames[i].waits, m_submitPoints[i]);
+    }
+    result = vkQueueSubmit(queue, static_cast<uint32_t>(m_submitInfos.size()), m_submitInfos.data(), fence);
+    if (result != VK_SUCCESS) {
+        // with a fence, every batch has the same point
+        size_t pointCount = m_fences.empty() ? m_submitPoints.size() : 1;
+        for (size_t i = 0; i < pointCount; i++) {
+            m_context->CancelSubmit(queue, m_submitPoints[i]);
+        }
+        throw VulkanException(result, "Failed to submit the coordinated command buffers:");
+    }
+    for (size_t i = 0; i < m_acquired.size(); i++) {
+        m_acquired[i]->SetSubmitted(m_canvasFrames[i], m_submitPoints[i]);
+    }
+    m_frames[m_currentFrame] = m_submitPoints.back();
+    m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+
+    m_presentResults.assign(m_swapchains.size(), VK_SUCCESS);
+    VkPresentInfoKHR presentInfo = CreatePresentInfoKHR();
+    result = vkQueuePresentKHR(m_acquired[0]->GetPresentQueue(), &presentInfo);
+    for (size_t i = 0; i < m_acquired.size(); i++) {
+        m_acquired[i]->FinishPresent(m_presentResults[i]);
+    }
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR && result != VK_ERROR_OUT_OF_DATE_KHR) {
+        throw VulkanException(result, "Failed to present the coordinated swapchain images:");
+    }
+    m_statistics.framesSubmitted++;
+    m_statistics.canvasesPresented += m_acquired.size();
+}
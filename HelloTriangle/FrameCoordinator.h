@@ -0,0 +1,62 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <memory>
+#include <vector>
+#include "VulkanCanvas.h"
+#include "VulkanContext.h"
+
+struct FrameCoordinatorStatistics {
+    // frames that submitted at least one canvas
+    uint64_t framesSubmitted = 0;
+    uint64_t canvasesPresented = 0;
+    // canvases left out of a frame because their swapchain was being recreated
+    uint64_t canvasesSkipped = 0;
+};
+
+// Renders several canvases that share a VulkanContext as one frame: all of their command buffers
+// go to the graphics queue in a single vkQueueSubmit and all of their swapchains are presented by
+// a single vkQueuePresentKHR. This saves a submission and a present per extra view and keeps the
+// views showing the same frame. The canvases keep their own frame slots; the coordinator's fences
+// stand in for the slots' in-flight fences while a canvas belongs to it. With timeline semaphores
+// the coordinator needs no fences: each canvas's batch signals a graphics timeline value of its own.
+class FrameCoordinator
+{
+public:
+    FrameCoordinator(std::shared_ptr<VulkanContext> context,
+        uint32_t framesInFlight = VulkanRenderer::DEFAULT_FRAMES_IN_FLIGHT);
+    virtual ~FrameCoordinator() noexcept;
+
+    // The canvas must use this coordinator's context, and its graphics and present queues must
+    // be those of the canvases already added. Once added, rendering any of the canvases renders
+    // all of them.
+    void AddCanvas(VulkanCanvas* canvas);
+    // Waits for the coordinator's frames in flight; called by a canvas that is being destroyed.
+    void RemoveCanvas(VulkanCanvas* canvas) noexcept;
+    void RenderFrame();
+    const FrameCoordinatorStatistics& GetStatistics() const noexcept { return m_statistics; }
+
+private:
+    VkFenceCreateInfo CreateFenceCreateInfo() const noexcept;
+    VkPresentInfoKHR CreatePresentInfoKHR() noexcept;
+    void WaitForFramesInFlight() noexcept;
+
+    std::shared_ptr<VulkanContext> m_context;
+    std::vector<VulkanCanvas*> m_canvases;
+    // empty with timeline semaphores
+    std::vector<VkFence> m_fences;
+    // where each of the coordinator's frames in flight completes
+    std::vector<SubmitPoint> m_frames;
+    size_t m_currentFrame;
+    FrameCoordinatorStatistics m_statistics;
+
+    // per-frame scratch, kept to avoid reallocating every frame
+    std::vector<VulkanCanvas*> m_acquired;
+    std::vector<CanvasFrame> m_canvasFrames;
+    std::vector<SubmitPoint> m_submitPoints;
+    std::vector<VkSubmitInfo> m_submitInfos;
+    std::vector<TimelineSubmit> m_timelineSubmits;
+    std::vector<VkSemaphore> m_presentWaits;
+    std::vector<VkSwapchainKHR> m_swapchains;
+    std::vector<uint32_t> m_imageIndices;
+    std::vector<VkResult> m_presentResults;
+};
@@ -0,0 +1,97 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <thread>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#pragma comment(lib, "winmm.lib")
+#endif
+
+void FrameTimeStatistics::AddSample(double milliseconds)
+{
+    ++frameCount;
+    lastMilliseconds = milliseconds;
+    if (frameCount == 1) {
+        minMilliseconds = milliseconds;
+        maxMilliseconds = milliseconds;
+    }
+    else {
+        minMilliseconds = std::min(minMilliseconds, milliseconds);
+        maxMilliseconds = std::max(maxMilliseconds, milliseconds);
+    }
+    double delta = milliseconds - meanMilliseconds;
+    meanMilliseconds += delta / frameCount;
+    sumSquaredDeviations += delta * (milliseconds - meanMilliseconds);
+}
+
+double FrameTimeStatistics::JitterMilliseconds() const
+{
+    return frameCount < 2 ? 0.0 : std::sqrt(sumSquaredDeviations / (frameCount - 1));
+}
+
+FramePacer::FramePacer()
+    : m_targetFrameRate(0.0), m_frameInterval(Clock::duration::zero()),
+    m_spinThreshold(std::chrono::milliseconds(2)), m_haveLastFrame(false)
+{
+#ifdef _WIN32
+    // raise the scheduler resolution so that Sleep is accurate to about a millisecond
+    ::timeBeginPeriod(1);
+#endif
+}
+
+
+FramePacer::~FramePacer()
+{
+#ifdef _WIN32
+    ::timeEndPeriod(1);
+#endif
+}
+
+void FramePacer::SetTargetFrameRate(double framesPerSecond)
+{
+    m_targetFrameRate = framesPerSecond > 0.0 ? framesPerSecond : 0.0;
+    if (m_targetFrameRate > 0.0) {
+        m_frameInterval = std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>(1.0 / m_targetFrameRate));
+    }
+    else {
+        m_frameInterval = Clock::duration::zero();
+    }
+    m_nextDeadline = Clock::now();
+}
+
+void FramePacer::WaitForNextFrame()
+{
+    if (m_frameInterval == Clock::duration::zero()) {
+        return;
+    }
+    Clock::time_point now = Clock::now();
+    if (now > m_nextDeadline + m_frameInterval) {
+        // more than a whole frame late; start again from now instead of rendering a burst to catch up
+        m_nextDeadline = now;
+    }
+    if (m_nextDeadline - now > m_spinThreshold) {
+        std::this_thread::sleep_for(m_nextDeadline - now - m_spinThreshold);
+    }
+    while (Clock::now() < m_nextDeadline) {
+        std::this_thread::yield();
+    }
+    m_nextDeadline += m_frameInterval;
+}
+
+void FramePacer::FrameCompleted()
+{
+    Clock::time_point now = Clock::now();
+    if (m_haveLastFrame) {
+        m_statistics.AddSample(std::chrono::duration<double, std::milli>(now - m_lastFrameEnd).count());
+    }
+    m_lastFrameEnd = now;
+    m_haveLastFrame = true;
+}
+
+void FramePacer::ResetStatistics() noexcept
+{
+    m_statistics = FrameTimeStatistics();
+    m_haveLastFrame = false;
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+
+// Frame-to-frame times in milliseconds, accumulated with Welford's method so that
+// the jitter (standard deviation) is available without keeping every sample.
+struct FrameTimeStatistics {
+    uint64_t frameCount = 0;
+    double lastMilliseconds = 0.0;
+    double minMilliseconds = 0.0;
+    double maxMilliseconds = 0.0;
+    double meanMilliseconds = 0.0;
+    double sumSquaredDeviations = 0.0;
+
+    void AddSample(double milliseconds);
+    double JitterMilliseconds() const;
+    double FramesPerSecond() const {
+        return meanMilliseconds <= 0.0 ? 0.0 : 1000.0 / meanMilliseconds;
+    }
+};
+
+// Holds a steady frame rate by sleeping until shortly before each frame's deadline and
+// spinning for the remainder, which avoids the coarse granularity of the OS sleep.
+class FramePacer
+{
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    FramePacer();
+    virtual ~FramePacer();
+
+    // 0 disables pacing; WaitForNextFrame then returns immediately.
+    void SetTargetFrameRate(double framesPerSecond);
+    double GetTargetFrameRate() const noexcept { return m_targetFrameRate; }
+    void WaitForNextFrame();
+    void FrameCompleted();
+    void ResetStatistics() noexcept;
+    const FrameTimeStatistics& GetStatistics() const noexcept { return m_statistics; }
+
+private:
+    double m_targetFrameRate;
+    Clock::duration m_frameInterval;
+    Clock::duration m_spinThreshold;
+    Clock::time_point m_nextDeadline;
+    Clock::time_point m_lastFrameEnd;
+    bool m_haveLastFrame;
+    FrameTimeStatistics m_statistics;
+};
@@ -0,0 +1,258 @@
+#include "FrameProfiler.h"
+#include "VulkanException.h"
+#include <algorithm>
+#include <fstream>
+
+const char* FrameStageName(FrameStage stage) noexcept
+{
+    switch (stage) {
+    case FrameStage::Acquire:
+        return "acquire";
+    case FrameStage::Record:
+        return "record";
+    case FrameStage::Submit:
+        return "submit";
+    case FrameStage::Present:
+        return "present";
+    case FrameStage::GpuRenderPass:
+        return "gpu_render_pass";
+    default:
+        return "unknown";
+    }
+}
+
+TimingHistogram::TimingHistogram(size_t capacity)
+    : m_samples(std::max<size_t>(capacity, 1)), m_next(0), m_full(false), m_totalSamples(0)
+{
+}
+
+void TimingHistogram::AddSample(double milliseconds)
+{
+    m_samples[m_next] = milliseconds;
+    m_next = (m_next + 1) % m_samples.size();
+    if (m_next == 0) {
+        m_full = true;
+    }
+    ++m_totalSamples;
+}
+
+void TimingHistogram::Clear() noexcept
+{
+    m_next = 0;
+    m_full = false;
+    m_totalSamples = 0;
+}
+
+double TimingHistogram::Percentile(double p) const
+{
+    size_t count = GetSampleCount();
+    if (count == 0) {
+        return 0.0;
+    }
+    std::vector<double> sorted(m_samples.begin(), m_samples.begin() + count);
+    p = std::min(std::max(p, 0.0), 100.0);
+    // nearest-rank percentile
+    size_t rank = static_cast<size_t>(p / 100.0 * (count - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    return sorted[rank];
+}
+
+double TimingHistogram::Mean() const noexcept
+{
+    size_t count = GetSampleCount();
+    if (count == 0) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (size_t i = 0; i < count; ++i) {
+        total += m_samples[i];
+    }
+    return total / count;
+}
+
+double TimingHistogram::Max() const noexcept
+{
+    size_t count = GetSampleCount();
+    return count == 0 ? 0.0 : *std::max_element(m_samples.begin(), m_samples.begin() + count);
+}
+
+FrameProfiler::FrameProfiler(size_t historySize)
+    : m_device(VK_NULL_HANDLE), m_queryPool(VK_NULL_HANDLE), m_timestampPeriod(1.0),
+    m_timestampMask(~0ull)
+{
+    m_histograms.fill(TimingHistogram(historySize));
+}
+
+
+FrameProfiler::~FrameProfiler() noexcept
+{
+    Destroy();
+}
+
+VkQueryPoolCreateInfo FrameProfiler::CreateQueryPoolCreateInfo(uint32_t queryCount) const noexcept
+{
+    VkQueryPoolCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    createInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    createInfo.queryCount = queryCount;
+    return createInfo;
+}
+
+void FrameProfiler::Create(VkDevice device, const PhysicalDeviceInfo& deviceInfo,
+    uint32_t queueFamily, uint32_t frameCount)
+{
+    Destroy();
+    m_device = device;
+
+    const std::vector<VkQueueFamilyProperties>& queueFamilies = deviceInfo.queueFamilies;
+    if (queueFamily >= queueFamilies.size() || queueFamilies[queueFamily].timestampValidBits == 0) {
+        // the queue cannot write timestamps; only the CPU stages are measured
+        return;
+    }
+    uint32_t validBits = queueFamilies[queueFamily].timestampValidBits;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    m_timestampPeriod = deviceInfo.properties.limits.timestampPeriod;
+
+    // a begin and an end timestamp for each frame slot
+    VkQueryPoolCreateInfo createInfo = CreateQueryPoolCreateInfo(frameCount * 2);
+    VkResult result = vkCreateQueryPool(m_device, &createInfo, nullptr, &m_queryPool);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Unable to create the timestamp query pool:");
+    }
+    m_queriesPending.assign(frameCount, false);
+}
+
+void FrameProfiler::Destroy() noexcept
+{
+    if (m_queryPool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+        m_queryPool = VK_NULL_HANDLE;
+    }
+    m_queriesPending.clear();
+}
+
+void FrameProfiler::WriteRenderPassBegin(VkCommandBuffer commandBuffer, uint32_t frameIndex) noexcept
+{
+    if (m_queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+    vkCmdResetQueryPool(commandBuffer, m_queryPool, frameIndex * 2, 2);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, frameIndex * 2);
+}
+
+void FrameProfiler::WriteRenderPassEnd(VkCommandBuffer commandBuffer, uint32_t frameIndex) noexcept
+{
+    if (m_queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, frameIndex * 2 + 1);
+    m_queriesPending[frameIndex] = true;
+}
+
+void FrameProfiler::ReuseRenderPassQueries(uint32_t frameIndex) noexcept
+{
+    if (m_queryPool == VK_NULL_HANDLE) {
+        return;
+    }
+    // the command buffer resets and writes the same queries again
+    m_queriesPending[frameIndex] = true;
+}
+
+void FrameProfiler::CollectGpuResults(uint32_t frameIndex)
+{
+    if (m_queryPool == VK_NULL_HANDLE || !m_queriesPending[frameIndex]) {
+        return;
+    }
+    uint64_t timestamps[2];
+    // no VK_QUERY_RESULT_WAIT_BIT: if the results are somehow not ready, skip the sample rather than stall
+    VkResult result = vkGetQueryPoolResults(m_device, m_queryPool, frameIndex * 2, 2, sizeof(timestamps),
+        timestamps, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result == VK_NOT_READY) {
+        return;
+    }
+    m_queriesPending[frameIndex] = false;
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Unable to read the timestamp query results:");
+    }
+    uint64_t ticks = ((timestamps[1] & m_timestampMask) - (timestamps[0] & m_timestampMask)) & m_timestampMask;
+    m_histograms[static_cast<size_t>(FrameStage::GpuRenderPass)].AddSample(ticks * m_timestampPeriod / 1.0e6);
+}
+
+void FrameProfiler::AddCpuSample(FrameStage stage, double milliseconds)
+{
+    m_histograms[static_cast<size_t>(stage)].AddSample(milliseconds);
+}
+
+const TimingHistogram& FrameProfiler::GetHistogram(FrameStage stage) const noexcept
+{
+    return m_histograms[static_cast<size_t>(stage)];
+}
+
+void FrameProfiler::Clear() noexcept
+{
+    for (auto& histogram : m_histograms) {
+        histogram.Clear();
+    }
+}
+
+void FrameProfiler::WriteCsv(std::ostream& out) const
+{
+    out << "stage,samples,mean_ms,p50_ms,p95_ms,p99_ms,max_ms\n";
+    for (size_t i = 0; i < m_histograms.size(); ++i) {
+        const TimingHistogram& histogram = m_histograms[i];
+        out << FrameStageName(static_cast<FrameStage>(i)) << ','
+            << histogram.GetSampleCount() << ','
+            << histogram.Mean() << ','
+            << histogram.Percentile(50.0) << ','
+            << histogram.Percentile(95.0) << ','
+            << histogram.Percentile(99.0) << ','
+            << histogram.Max() << '\n';
+    }
+}
+
+void FrameProfiler::WriteJson(std::ostream& out) const
+{
+    out << "{\n";
+    for (size_t i = 0; i < m_histograms.size(); ++i) {
+        const TimingHistogram& histogram = m_histograms[i];
+        out << "  \"" << FrameStageName(static_cast<FrameStage>(i)) << "\": { "
+            << "\"samples\": " << histogram.GetSampleCount()
+            << ", \"mean_ms\": " << histogram.Mean()
+            << ", \"p50_ms\": " << histogram.Percentile(50.0)
+            << ", \"p95_ms\": " << histogram.Percentile(95.0)
+            << ", \"p99_ms\": " << histogram.Percentile(99.0)
+            << ", \"max_ms\": " << histogram.Max() << " }"
+            << (i + 1 < m_histograms.size() ? ",\n" : "\n");
+    }
+    out << "}\n";
+}
+
+bool FrameProfiler::Dump(const std::string& fileName) const
+{
+    std::ofstream out(fileName);
+    if (!out) {
+        return false;
+    }
+    const std::string jsonExtension = ".json";
+    if (fileName.size() >= jsonExtension.size() &&
+        fileName.compare(fileName.size() - jsonExtension.size(), jsonExtension.size(), jsonExtension) == 0) {
+        WriteJson(out);
+    }
+    else {
+        WriteCsv(out);
+    }
+    return static_cast<bool>(out);
+}
+
+StageTimer::StageTimer(FrameProfiler& profiler, FrameStage stage)
+    : m_profiler(profiler), m_stage(stage), m_start(std::chrono::steady_clock::now())
+{
+}
+
+
+StageTimer::~StageTimer()
+{
+    auto end = std::chrono::steady_clock::now();
+    m_profiler.AddCpuSample(m_stage, std::chrono::duration<double, std::milli>(end - m_start).count());
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "DeviceSelector.h"
+
+// The parts of a frame that are timed. GpuRenderPass is measured with timestamp queries;
+// the others are CPU wall-clock times on the rendering thread.
+enum class FrameStage {
+    Acquire,
+    Record,
+    Submit,
+    Present,
+    GpuRenderPass,
+    Count
+};
+
+const char* FrameStageName(FrameStage stage) noexcept;
+
+// The most recent samples of one timing, in milliseconds. Older samples are overwritten once
+// the window is full, so the percentiles describe recent behaviour rather than the whole run.
+class TimingHistogram
+{
+public:
+    static const size_t DEFAULT_CAPACITY = 1024;
+
+    TimingHistogram(size_t capacity = DEFAULT_CAPACITY);
+
+    void AddSample(double milliseconds);
+    void Clear() noexcept;
+    size_t GetSampleCount() const noexcept { return m_full ? m_samples.size() : m_next; }
+    uint64_t GetTotalSampleCount() const noexcept { return m_totalSamples; }
+    // p is in the range [0, 100]
+    double Percentile(double p) const;
+    double Mean() const noexcept;
+    double Max() const noexcept;
+
+private:
+    std::vector<double> m_samples;
+    size_t m_next;
+    bool m_full;
+    uint64_t m_totalSamples;
+};
+
+// Collects per-stage frame timings. GPU time is taken from a pair of timestamps written around
+// the render pass of each frame slot; the results are only read once that slot's fence has
+// signaled, so reading them never stalls the CPU.
+class FrameProfiler
+{
+public:
+    FrameProfiler(size_t historySize = TimingHistogram::DEFAULT_CAPACITY);
+    virtual ~FrameProfiler() noexcept;
+
+    void Create(VkDevice device, const PhysicalDeviceInfo& deviceInfo, uint32_t queueFamily, uint32_t frameCount);
+    void Destroy() noexcept;
+    bool IsGpuTimingAvailable() const noexcept { return m_queryPool != VK_NULL_HANDLE; }
+
+    // Must be called outside a render pass, before it begins.
+    void WriteRenderPassBegin(VkCommandBuffer commandBuffer, uint32_t frameIndex) noexcept;
+    void WriteRenderPassEnd(VkCommandBuffer commandBuffer, uint32_t frameIndex) noexcept;
+    // For a command buffer recorded with the two calls above that is submitted again unchanged.
+    void ReuseRenderPassQueries(uint32_t frameIndex) noexcept;
+    // Call after waiting on the frame slot's fence.
+    void CollectGpuResults(uint32_t frameIndex);
+    void AddCpuSample(FrameStage stage, double milliseconds);
+
+    const TimingHistogram& GetHistogram(FrameStage stage) const noexcept;
+    void Clear() noexcept;
+    void WriteCsv(std::ostream& out) const;
+    void WriteJson(std::ostream& out) const;
+    // Writes JSON if the file name ends in .json, CSV otherwise.
+    bool Dump(const std::string& fileName) const;
+
+private:
+    VkQueryPoolCreateInfo CreateQueryPoolCreateInfo(uint32_t queryCount) const noexcept;
+
+    VkDevice m_device;
+    VkQueryPool m_queryPool;
+    double m_timestampPeriod;
+    uint64_t m_timestampMask;
+    std::vector<bool> m_queriesPending;
+    std::array<TimingHistogram, static_cast<size_t>(FrameStage::Count)> m_histograms;
+};
+
+// Adds the time between its construction and destruction to a CPU stage of a FrameProfiler.
+class StageTimer
+{
+public:
+    StageTimer(FrameProfiler& profiler, FrameStage stage);
+    ~StageTimer();
+
+private:
+    FrameProfiler& m_profiler;
+    FrameStage m_stage;
+    std::chrono::steady_clock::time_point m_start;
+};
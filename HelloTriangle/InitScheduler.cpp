@@ -0,0 +1,86 @@
+#include "InitScheduler.h"
+#include <chrono>
+#include <stdexcept>
+
+InitScheduler::InitScheduler()
+{
+}
+
+
+InitScheduler::~InitScheduler()
+{
+}
+
+void InitScheduler::Add(const std::string& name, Thread thread, Task task,
+    const std::vector<std::string>& dependencies)
+{
+    Step step = { name, thread, task, {} };
+    for (const auto& dependency : dependencies) {
+        size_t index = 0;
+        while (index < m_steps.size() && m_steps[index].name != dependency) {
+            ++index;
+        }
+        if (index == m_steps.size()) {
+            throw std::runtime_error("Programming Error:\nInitialization step " + name +
+                " depends on " + dependency + ", which has not been added.");
+        }
+        step.dependencies.push_back(index);
+    }
+    m_steps.push_back(step);
+}
+
+void InitScheduler::RunStep(size_t index, const std::vector<std::shared_future<void>>& dependencies)
+{
+    // get() rethrows if a dependency failed, so this step fails with the same error
+    for (auto dependency : dependencies) {
+        dependency.get();
+    }
+    auto start = std::chrono::steady_clock::now();
+    m_steps[index].task();
+    auto end = std::chrono::steady_clock::now();
+    m_timings[index] = { m_steps[index].name, std::chrono::duration<double, std::milli>(end - start).count() };
+}
+
+void InitScheduler::Run()
+{
+    m_timings.assign(m_steps.size(), InitStepTiming());
+    std::vector<std::shared_future<void>> finished(m_steps.size());
+    std::exception_ptr error;
+    size_t started = 0;
+    for (; started < m_steps.size() && !error; ++started) {
+        std::vector<std::shared_future<void>> dependencies;
+        for (size_t dependency : m_steps[started].dependencies) {
+            dependencies.push_back(finished[dependency]);
+        }
+        if (m_steps[started].thread == Thread::Worker) {
+            finished[started] = std::async(std::launch::async,
+                &InitScheduler::RunStep, this, started, dependencies).share();
+        }
+        else {
+            std::promise<void> done;
+            try {
+                RunStep(started, dependencies);
+                done.set_value();
+            }
+            catch (...) {
+                error = std::current_exception();
+                done.set_exception(error);
+            }
+            finished[started] = done.get_future().share();
+        }
+    }
+    // the worker steps use the objects being initialized, so they must all finish before any error is reported
+    for (size_t i = 0; i < started; ++i) {
+        try {
+            finished[i].get();
+        }
+        catch (...) {
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+#include <functional>
+#include <future>
+#include <string>
+#include <vector>
+
+// Wall-clock time taken by one step of a renderer's initialization sequence
+struct InitStepTiming {
+    std::string name;
+    double milliseconds;
+};
+
+// Runs a renderer's initialization steps, moving the ones marked Worker onto their own threads
+// so that they overlap with the steps that must stay on the calling thread. Steps are run in
+// the order they were added; a step starts only once the steps it depends on have finished.
+// Run does not return until every started step has finished, and then rethrows the first
+// exception thrown by any of them.
+class InitScheduler
+{
+public:
+    typedef std::function<void()> Task;
+
+    enum class Thread {
+        Caller,
+        Worker
+    };
+
+    InitScheduler();
+    virtual ~InitScheduler();
+
+    void Add(const std::string& name, Thread thread, Task task,
+        const std::vector<std::string>& dependencies = std::vector<std::string>());
+    void Run();
+    const std::vector<InitStepTiming>& GetTimings() const noexcept { return m_timings; }
+
+private:
+    struct Step {
+        std::string name;
+        Thread thread;
+        Task task;
+        std::vector<size_t> dependencies;
+    };
+
+    void RunStep(size_t index, const std::vector<std::shared_future<void>>& dependencies);
+
+    std::vector<Step> m_steps;
+    std::vector<InitStepTiming> m_timings;
+};
@@ -0,0 +1,189 @@
+#include "ParallelRecorder.h"
+#include "VulkanException.h"
+#include <algorithm>
+
+ParallelRecorder::ParallelRecorder()
+    : m_device(VK_NULL_HANDLE), m_threadCount(0), m_frameIndex(0), m_inheritanceInfo(nullptr),
+    m_itemCount(0), m_recordSlice(nullptr), m_generation(0), m_pending(0), m_stopping(false)
+{
+}
+
+
+ParallelRecorder::~ParallelRecorder() noexcept
+{
+    Destroy();
+}
+
+VkCommandPoolCreateInfo ParallelRecorder::CreateCommandPoolCreateInfo(uint32_t queueFamily) const noexcept
+{
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // the whole pool is reset each time its frame is recorded
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamily;
+    return poolInfo;
+}
+
+VkCommandBufferBeginInfo ParallelRecorder::CreateCommandBufferBeginInfo() const noexcept
+{
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    // not one-time-submit: the primary that executes it may be submitted again unchanged
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = m_inheritanceInfo;
+    return beginInfo;
+}
+
+void ParallelRecorder::Create(VkDevice device, uint32_t queueFamily, uint32_t frameCount, uint32_t threadCount)
+{
+    if (threadCount == 0) {
+        throw std::runtime_error("Programming Error:\nParallelRecorder needs at least one thread.");
+    }
+    Destroy();
+    m_device = device;
+    m_threadCount = threadCount;
+    m_threadFrames.resize(frameCount * threadCount);
+    for (auto& threadFrame : m_threadFrames) {
+        VkCommandPoolCreateInfo poolInfo = CreateCommandPoolCreateInfo(queueFamily);
+        VkResult result = vkCreateCommandPool(m_device, &poolInfo, nullptr, &threadFrame.commandPool);
+        if (result != VK_SUCCESS) {
+            Destroy();
+            throw VulkanException(result, "Failed to create a recording thread's command pool:");
+        }
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = threadFrame.commandPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+        result = vkAllocateCommandBuffers(m_device, &allocInfo, &threadFrame.commandBuffer);
+        if (result != VK_SUCCESS) {
+            Destroy();
+            throw VulkanException(result, "Failed to allocate a secondary command buffer:");
+        }
+    }
+    m_recorded.assign(threadCount, VK_NULL_HANDLE);
+    m_errors.assign(threadCount, nullptr);
+    m_stopping = false;
+    // the new workers start at generation 0, so they must not see the last job of the old ones
+    m_generation = 0;
+    m_pending = 0;
+    m_inheritanceInfo = nullptr;
+    m_recordSlice = nullptr;
+    for (uint32_t thread = 1; thread < threadCount; ++thread) {
+        m_workers.emplace_back(&ParallelRecorder::WorkerMain, this, thread);
+    }
+}
+
+void ParallelRecorder::Destroy() noexcept
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_workAvailable.notify_all();
+    for (auto& worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+    // freeing a pool frees its command buffers
+    for (auto& threadFrame : m_threadFrames) {
+        if (threadFrame.commandPool != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(m_device, threadFrame.commandPool, nullptr);
+        }
+    }
+    m_threadFrames.clear();
+    m_result.clear();
+    m_threadCount = 0;
+}
+
+void ParallelRecorder::WorkerMain(uint32_t threadIndex)
+{
+    uint64_t generation = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_workAvailable.wait(lock, [&] { return m_stopping || m_generation != generation; });
+            if (m_stopping) {
+                return;
+            }
+            generation = m_generation;
+        }
+        RecordThreadSlice(threadIndex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_pending;
+        }
+        m_workDone.notify_one();
+    }
+}
+
+void ParallelRecorder::RecordThreadSlice(uint32_t threadIndex) noexcept
+{
+    m_recorded[threadIndex] = VK_NULL_HANDLE;
+    m_errors[threadIndex] = nullptr;
+    // spread the remainder over the first slices so that they differ by at most one item
+    uint32_t sliceSize = m_itemCount / m_threadCount;
+    uint32_t remainder = m_itemCount % m_threadCount;
+    uint32_t begin = threadIndex * sliceSize + std::min(threadIndex, remainder);
+    uint32_t end = begin + sliceSize + (threadIndex < remainder ? 1 : 0);
+    if (begin == end) {
+        return;
+    }
+    try {
+        ThreadFrame& threadFrame = m_threadFrames[m_frameIndex * m_threadCount + threadIndex];
+        VkResult result = vkResetCommandPool(m_device, threadFrame.commandPool, 0);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to reset a recording thread's command pool:");
+        }
+        VkCommandBufferBeginInfo beginInfo = CreateCommandBufferBeginInfo();
+        result = vkBeginCommandBuffer(threadFrame.commandBuffer, &beginInfo);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to begin recording a secondary command buffer:");
+        }
+        (*m_recordSlice)(threadFrame.commandBuffer, begin, end);
+        result = vkEndCommandBuffer(threadFrame.commandBuffer);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to record a secondary command buffer:");
+        }
+        m_recorded[threadIndex] = threadFrame.commandBuffer;
+    }
+    catch (...) {
+        m_errors[threadIndex] = std::current_exception();
+    }
+}
+
+const std::vector<VkCommandBuffer>& ParallelRecorder::Record(uint32_t frameIndex,
+    const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t itemCount, const RecordSlice& recordSlice)
+{
+    if (m_threadCount == 0) {
+        throw std::runtime_error("Programming Error:\nParallelRecorder::Record called before Create.");
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frameIndex = frameIndex;
+        m_inheritanceInfo = &inheritanceInfo;
+        m_itemCount = itemCount;
+        m_recordSlice = &recordSlice;
+        m_pending = m_threadCount - 1;
+        ++m_generation;
+    }
+    m_workAvailable.notify_all();
+    RecordThreadSlice(0);
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_workDone.wait(lock, [&] { return m_pending == 0; });
+    }
+
+    for (auto& error : m_errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+    m_result.clear();
+    for (auto commandBuffer : m_recorded) {
+        if (commandBuffer != VK_NULL_HANDLE) {
+            m_result.push_back(commandBuffer);
+        }
+    }
+    return m_result;
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Records secondary command buffers for one render pass on several threads. The calling thread
+// records the first slice and persistent worker threads record the rest, so no threads are
+// started per frame. Every thread has its own command pool for each frame in flight: a pool is
+// only ever used by one thread, and all of a frame's command buffers are recycled at once by
+// resetting its pools when the frame is recorded again.
+class ParallelRecorder
+{
+public:
+    // Records items [begin, end) into a secondary command buffer that has already been begun.
+    typedef std::function<void(VkCommandBuffer commandBuffer, uint32_t begin, uint32_t end)> RecordSlice;
+
+    ParallelRecorder();
+    virtual ~ParallelRecorder() noexcept;
+
+    // threadCount includes the calling thread
+    void Create(VkDevice device, uint32_t queueFamily, uint32_t frameCount, uint32_t threadCount);
+    void Destroy() noexcept;
+
+    // Splits itemCount items into contiguous slices, one per thread, records them in parallel and
+    // returns the non-empty secondary command buffers in item order. The command buffers last
+    // returned for frameIndex must no longer be in use by the GPU.
+    const std::vector<VkCommandBuffer>& Record(uint32_t frameIndex,
+        const VkCommandBufferInheritanceInfo& inheritanceInfo, uint32_t itemCount,
+        const RecordSlice& recordSlice);
+    uint32_t GetThreadCount() const noexcept { return m_threadCount; }
+
+private:
+    struct ThreadFrame {
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    };
+
+    VkCommandPoolCreateInfo CreateCommandPoolCreateInfo(uint32_t queueFamily) const noexcept;
+    VkCommandBufferBeginInfo CreateCommandBufferBeginInfo() const noexcept;
+    void WorkerMain(uint32_t threadIndex);
+    void RecordThreadSlice(uint32_t threadIndex) noexcept;
+
+    VkDevice m_device;
+    uint32_t m_threadCount;
+    // indexed by frame * m_threadCount + thread
+    std::vector<ThreadFrame> m_threadFrames;
+    std::vector<std::thread> m_workers;
+
+    // the current job; written by the calling thread while the workers are idle
+    uint32_t m_frameIndex;
+    const VkCommandBufferInheritanceInfo* m_inheritanceInfo;
+    uint32_t m_itemCount;
+    const RecordSlice* m_recordSlice;
+    std::vector<VkCommandBuffer> m_recorded;
+    std::vector<std::exception_ptr> m_errors;
+    std::vector<VkCommandBuffer> m_result;
+
+    std::mutex m_mutex;
+    std::condition_variable m_workAvailable;
+    std::condition_variable m_workDone;
+    uint64_t m_generation;
+    uint32_t m_pending;
+    bool m_stopping;
+};
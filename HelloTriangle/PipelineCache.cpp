@@ -0,0 +1,189 @@
+#include "PipelineCache.h"
+#include "VulkanException.h"
+#include <fstream>
+#include <cstring>
+#include <cstdio>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#endif
+
+// layout of the version one header that starts every pipeline cache blob
+const size_t cacheHeaderSize = 16 + VK_UUID_SIZE;
+
+PipelineCache::PipelineCache(const std::string& fileName)
+    : m_fileName(fileName), m_device(VK_NULL_HANDLE), m_pipelineCache(VK_NULL_HANDLE)
+{
+}
+
+
+PipelineCache::~PipelineCache() noexcept
+{
+    Destroy();
+}
+
+VkPipelineCacheCreateInfo PipelineCache::CreatePipelineCacheCreateInfo(
+    const std::vector<char>& initialData) const noexcept
+{
+    VkPipelineCacheCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    createInfo.initialDataSize = initialData.size();
+    createInfo.pInitialData = initialData.empty() ? nullptr : initialData.data();
+    return createInfo;
+}
+
+void PipelineCache::Create(VkDevice device, VkPhysicalDevice physicalDevice)
+{
+    m_device = device;
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    std::vector<char> initialData;
+    if (!ReadCacheFile(initialData)) {
+        m_statistics.rejectReason = "no cache file";
+        initialData.clear();
+    }
+    else if (!ValidateHeader(initialData, properties, m_statistics.rejectReason)) {
+        initialData.clear();
+    }
+
+    VkPipelineCacheCreateInfo createInfo = CreatePipelineCacheCreateInfo(initialData);
+    VkResult result = vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache);
+    if (result != VK_SUCCESS && !initialData.empty()) {
+        // the header was fine but the driver rejected the contents; start again from empty
+        m_statistics.rejectReason = "rejected by the driver";
+        initialData.clear();
+        createInfo = CreatePipelineCacheCreateInfo(initialData);
+        result = vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_pipelineCache);
+    }
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to create pipeline cache:");
+    }
+    m_statistics.loadedFromDisk = !initialData.empty();
+    m_statistics.loadedBytes = initialData.size();
+}
+
+void PipelineCache::Destroy() noexcept
+{
+    if (m_pipelineCache != VK_NULL_HANDLE) {
+        Save();
+        vkDestroyPipelineCache(m_device, m_pipelineCache, nullptr);
+        m_pipelineCache = VK_NULL_HANDLE;
+    }
+}
+
+bool PipelineCache::Save() noexcept
+{
+    if (m_pipelineCache == VK_NULL_HANDLE) {
+        return false;
+    }
+    size_t dataSize = 0;
+    VkResult result = vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, nullptr);
+    if (result != VK_SUCCESS || dataSize == 0) {
+        return false;
+    }
+    if (dataSize == m_statistics.savedBytes) {
+        // nothing has been added since the last save
+        return true;
+    }
+    try {
+        std::vector<char> data(dataSize);
+        result = vkGetPipelineCacheData(m_device, m_pipelineCache, &dataSize, data.data());
+        if (result != VK_SUCCESS) {
+            return false;
+        }
+        data.resize(dataSize);
+        if (!WriteCacheFile(data)) {
+            return false;
+        }
+        m_statistics.savedBytes = dataSize;
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+void PipelineCache::RecordPipelineCreation(double milliseconds) noexcept
+{
+    if (m_statistics.loadedFromDisk) {
+        ++m_statistics.warmCreateCount;
+        m_statistics.warmCreateMilliseconds += milliseconds;
+    }
+    else {
+        ++m_statistics.coldCreateCount;
+        m_statistics.coldCreateMilliseconds += milliseconds;
+    }
+}
+
+bool PipelineCache::ValidateHeader(const std::vector<char>& data,
+    const VkPhysicalDeviceProperties& properties, std::string& reason) const
+{
+    if (data.size() < cacheHeaderSize) {
+        reason = "file is too short to hold a pipeline cache header";
+        return false;
+    }
+    uint32_t headerLength;
+    uint32_t headerVersion;
+    uint32_t vendorID;
+    uint32_t deviceID;
+    std::memcpy(&headerLength, data.data(), sizeof(uint32_t));
+    std::memcpy(&headerVersion, data.data() + 4, sizeof(uint32_t));
+    std::memcpy(&vendorID, data.data() + 8, sizeof(uint32_t));
+    std::memcpy(&deviceID, data.data() + 12, sizeof(uint32_t));
+    if (headerLength < cacheHeaderSize || headerLength > data.size()) {
+        reason = "invalid header length";
+        return false;
+    }
+    if (headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE) {
+        reason = "unsupported header version";
+        return false;
+    }
+    if (vendorID != properties.vendorID || deviceID != properties.deviceID) {
+        reason = "written by a different device";
+        return false;
+    }
+    if (std::memcmp(data.data() + 16, properties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        reason = "written by a different driver version";
+        return false;
+    }
+    reason.clear();
+    return true;
+}
+
+bool PipelineCache::ReadCacheFile(std::vector<char>& data) const
+{
+    std::ifstream file(m_fileName, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    size_t fileSize = (size_t)file.tellg();
+    data.resize(fileSize);
+    file.seekg(0);
+    file.read(data.data(), fileSize);
+    return static_cast<bool>(file);
+}
+
+bool PipelineCache::WriteCacheFile(const std::vector<char>& data) const
+{
+    // write to a temporary file and move it over the old one, so that a crash part way
+    // through never leaves a half-written cache behind
+    std::string tempFileName = m_fileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+        file.write(data.data(), data.size());
+        file.flush();
+        if (!file) {
+            return false;
+        }
+    }
+#ifdef _WIN32
+    return ::MoveFileExA(tempFileName.c_str(), m_fileName.c_str(),
+        MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return std::rename(tempFileName.c_str(), m_fileName.c_str()) == 0;
+#endif
+}
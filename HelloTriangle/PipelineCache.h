@@ -0,0 +1,52 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+// Pipeline creation times, split by whether the cache was primed from disk
+struct PipelineCacheStatistics {
+    bool loadedFromDisk = false;
+    std::string rejectReason;
+    size_t loadedBytes = 0;
+    size_t savedBytes = 0;
+    uint64_t warmCreateCount = 0;
+    double warmCreateMilliseconds = 0.0;
+    uint64_t coldCreateCount = 0;
+    double coldCreateMilliseconds = 0.0;
+
+    double AverageWarmMilliseconds() const {
+        return warmCreateCount == 0 ? 0.0 : warmCreateMilliseconds / warmCreateCount;
+    }
+    double AverageColdMilliseconds() const {
+        return coldCreateCount == 0 ? 0.0 : coldCreateMilliseconds / coldCreateCount;
+    }
+};
+
+// A VkPipelineCache that is persisted between runs. The blob on disk is only used if its
+// header matches the current driver (vendor ID, device ID and pipeline cache UUID); anything
+// else, including a truncated or corrupted file, falls back to an empty cache.
+class PipelineCache
+{
+public:
+    PipelineCache(const std::string& fileName);
+    virtual ~PipelineCache() noexcept;
+
+    void Create(VkDevice device, VkPhysicalDevice physicalDevice);
+    void Destroy() noexcept;
+    bool Save() noexcept;
+    void RecordPipelineCreation(double milliseconds) noexcept;
+    VkPipelineCache GetHandle() const noexcept { return m_pipelineCache; }
+    const PipelineCacheStatistics& GetStatistics() const noexcept { return m_statistics; }
+
+private:
+    VkPipelineCacheCreateInfo CreatePipelineCacheCreateInfo(const std::vector<char>& initialData) const noexcept;
+    bool ValidateHeader(const std::vector<char>& data, const VkPhysicalDeviceProperties& properties,
+        std::string& reason) const;
+    bool ReadCacheFile(std::vector<char>& data) const;
+    bool WriteCacheFile(const std::vector<char>& data) const;
+
+    std::string m_fileName;
+    VkDevice m_device;
+    VkPipelineCache m_pipelineCache;
+    PipelineCacheStatistics m_statistics;
+};
@@ -0,0 +1,158 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstddef>
+
+// Fixed-function pipeline state as constexpr values, so that the presets are built when the
+// program is compiled and pipeline creation only copies them into the create info structures.
+// Every preset is made of 4 byte members, so none has padding and they can be hashed as bytes.
+
+struct TopologyPreset {
+    VkPrimitiveTopology topology;
+    VkBool32 primitiveRestartEnable;
+
+    static constexpr TopologyPreset TriangleList() noexcept { return { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE }; }
+    static constexpr TopologyPreset TriangleStrip() noexcept { return { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP, VK_TRUE }; }
+
+    constexpr bool operator==(const TopologyPreset& other) const noexcept {
+        return topology == other.topology && primitiveRestartEnable == other.primitiveRestartEnable;
+    }
+
+    constexpr VkPipelineInputAssemblyStateCreateInfo GetInputAssemblyState() const noexcept
+    {
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
+        inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssembly.topology = topology;
+        inputAssembly.primitiveRestartEnable = primitiveRestartEnable;
+        return inputAssembly;
+    }
+};
+
+// Filled polygons; only culling and winding vary
+struct RasterPreset {
+    VkCullModeFlags cullMode;
+    VkFrontFace frontFace;
+
+    static constexpr RasterPreset BackFaceCulling() noexcept { return { VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_CLOCKWISE }; }
+    static constexpr RasterPreset TwoSided() noexcept { return { VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE }; }
+
+    constexpr bool operator==(const RasterPreset& other) const noexcept {
+        return cullMode == other.cullMode && frontFace == other.frontFace;
+    }
+
+    constexpr VkPipelineRasterizationStateCreateInfo GetRasterizationState() const noexcept
+    {
+        VkPipelineRasterizationStateCreateInfo rasterizer = {};
+        rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer.depthClampEnable = VK_FALSE;
+        rasterizer.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+        rasterizer.lineWidth = 1.0f;
+        rasterizer.cullMode = cullMode;
+        rasterizer.frontFace = frontFace;
+        rasterizer.depthBiasEnable = VK_FALSE;
+        return rasterizer;
+    }
+};
+
+struct BlendPreset {
+    VkBool32 blendEnable;
+    VkBlendFactor srcColorBlendFactor;
+    VkBlendFactor dstColorBlendFactor;
+    VkBlendFactor srcAlphaBlendFactor;
+    VkBlendFactor dstAlphaBlendFactor;
+
+    static constexpr BlendPreset Opaque() noexcept
+    {
+        return { VK_FALSE, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO };
+    }
+    // source alpha over what is already there
+    static constexpr BlendPreset AlphaBlend() noexcept
+    {
+        return { VK_TRUE, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA,
+            VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO };
+    }
+    static constexpr BlendPreset Additive() noexcept
+    {
+        return { VK_TRUE, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO };
+    }
+
+    constexpr bool operator==(const BlendPreset& other) const noexcept {
+        return blendEnable == other.blendEnable && srcColorBlendFactor == other.srcColorBlendFactor &&
+            dstColorBlendFactor == other.dstColorBlendFactor && srcAlphaBlendFactor == other.srcAlphaBlendFactor &&
+            dstAlphaBlendFactor == other.dstAlphaBlendFactor;
+    }
+
+    constexpr VkPipelineColorBlendAttachmentState GetAttachmentState() const noexcept
+    {
+        VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
+        colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+            VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        colorBlendAttachment.blendEnable = blendEnable;
+        colorBlendAttachment.srcColorBlendFactor = srcColorBlendFactor;
+        colorBlendAttachment.dstColorBlendFactor = dstColorBlendFactor;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = srcAlphaBlendFactor;
+        colorBlendAttachment.dstAlphaBlendFactor = dstAlphaBlendFactor;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+        return colorBlendAttachment;
+    }
+};
+
+// The specialization constants of shader.frag, which select its variant when the pipeline is
+// compiled instead of there being one .spv file per variant
+struct FragmentVariant {
+    // constant_id 0: output the colour's luminance
+    VkBool32 grayscale;
+    // constant_id 1: the output alpha, which only shows with a blending preset
+    float opacity;
+
+    static constexpr FragmentVariant Shaded() noexcept { return { VK_FALSE, 1.0f }; }
+    static constexpr FragmentVariant Grayscale() noexcept { return { VK_TRUE, 1.0f }; }
+    static constexpr FragmentVariant Translucent(float opacity) noexcept { return { VK_FALSE, opacity }; }
+
+    constexpr bool operator==(const FragmentVariant& other) const noexcept {
+        return grayscale == other.grayscale && opacity == other.opacity;
+    }
+
+    static constexpr std::array<VkSpecializationMapEntry, 2> GetMapEntries() noexcept
+    {
+        return { {
+            { 0, offsetof(FragmentVariant, grayscale), sizeof(VkBool32) },
+            { 1, offsetof(FragmentVariant, opacity), sizeof(float) }
+        } };
+    }
+
+    // points at this variant and at entries, which must outlive pipeline creation
+    constexpr VkSpecializationInfo GetSpecializationInfo(
+        const std::array<VkSpecializationMapEntry, 2>& entries) const noexcept
+    {
+        VkSpecializationInfo specializationInfo = {};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(entries.size());
+        specializationInfo.pMapEntries = &entries[0];
+        specializationInfo.dataSize = sizeof(FragmentVariant);
+        specializationInfo.pData = this;
+        return specializationInfo;
+    }
+};
+
+// The fixed-function state and shader variant that can differ between the pipelines of one renderer
+struct PipelineState {
+    TopologyPreset topology = TopologyPreset::TriangleList();
+    RasterPreset raster = RasterPreset::BackFaceCulling();
+    BlendPreset blend = BlendPreset::Opaque();
+    FragmentVariant fragment = FragmentVariant::Shaded();
+
+    static constexpr PipelineState Opaque() noexcept { return PipelineState(); }
+    static constexpr PipelineState Translucent(float opacity) noexcept
+    {
+        return { TopologyPreset::TriangleList(), RasterPreset::TwoSided(), BlendPreset::AlphaBlend(),
+            FragmentVariant::Translucent(opacity) };
+    }
+
+    constexpr bool operator==(const PipelineState& other) const noexcept {
+        return topology == other.topology && raster == other.raster && blend == other.blend &&
+            fragment == other.fragment;
+    }
+    constexpr bool operator!=(const PipelineState& other) const noexcept { return !(*this == other); }
+};
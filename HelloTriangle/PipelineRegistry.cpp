@@ -0,0 +1,235 @@
+#include "PipelineRegistry.h"
+#include <chrono>
+#include <exception>
+#include <vector>
+
+// FNV-1a over the bytes of value
+template<typename T>
+static void HashValue(size_t& hash, const T& value) noexcept
+{
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+    for (size_t i = 0; i < sizeof(value); ++i) {
+        hash ^= bytes[i];
+        hash *= static_cast<size_t>(1099511628211ull);
+    }
+}
+
+// field by field, so that padding does not take part
+size_t PipelineKeyHash::operator()(const PipelineKey& key) const noexcept
+{
+    size_t hash = static_cast<size_t>(14695981039346656037ull);
+    HashValue(hash, key.vertexShader);
+    HashValue(hash, key.fragmentShader);
+    HashValue(hash, key.layout);
+    HashValue(hash, key.colorFormat);
+    // the presets have no padding
+    HashValue(hash, key.state.topology);
+    HashValue(hash, key.state.raster);
+    HashValue(hash, key.state.blend);
+    HashValue(hash, key.state.fragment);
+    return hash;
+}
+
+PipelineRegistry::PipelineRegistry()
+    : m_device(VK_NULL_HANDLE), m_pipelineCache(nullptr), m_workerCompiles(0)
+{
+}
+
+
+PipelineRegistry::~PipelineRegistry() noexcept
+{
+    Destroy();
+}
+
+void PipelineRegistry::Create(VkDevice device, PipelineCache& pipelineCache) noexcept
+{
+    m_device = device;
+    m_pipelineCache = &pipelineCache;
+}
+
+void PipelineRegistry::Destroy() noexcept
+{
+    // waited for without m_mutex, which a finishing worker takes
+    std::unordered_map<PipelineKey, Entry, PipelineKeyHash> pipelines;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        pipelines.swap(m_pipelines);
+    }
+    for (auto& entry : pipelines) {
+        DestroyEntry(entry.second);
+    }
+}
+
+VkPipeline PipelineRegistry::CompileTimed(const Compile& compile)
+{
+    auto start = std::chrono::steady_clock::now();
+    VkPipeline pipeline = compile();
+    auto end = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> lock(m_cacheMutex);
+    m_pipelineCache->RecordPipelineCreation(std::chrono::duration<double, std::milli>(end - start).count());
+    return pipeline;
+}
+
+// Once no other compile is running, writes the new pipelines back rather than relying on a clean
+// shutdown; this also picks up pipelines compiled by GetOrCompile since the last save.
+VkPipeline PipelineRegistry::CompileOnWorker(const Compile& compile)
+{
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    std::exception_ptr error;
+    try {
+        pipeline = CompileTimed(compile);
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    bool lastCompile;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        lastCompile = --m_workerCompiles == 0;
+    }
+    if (lastCompile) {
+        std::lock_guard<std::mutex> lock(m_cacheMutex);
+        m_pipelineCache->Save();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return pipeline;
+}
+
+// Collects the pipeline of a compile that has finished; called with m_mutex held. Rethrows if the
+// compile failed.
+bool PipelineRegistry::IsReady(Entry& entry)
+{
+    if (entry.pending.valid()) {
+        if (entry.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+        entry.pipeline = entry.pending.get();
+        entry.pending = std::shared_future<VkPipeline>();
+    }
+    return true;
+}
+
+// Waits for the entry's compile if it is running, so must not be called with m_mutex held.
+void PipelineRegistry::DestroyEntry(Entry& entry) noexcept
+{
+    if (entry.pending.valid()) {
+        try {
+            entry.pipeline = entry.pending.get();
+        }
+        catch (...) {
+            entry.pipeline = VK_NULL_HANDLE;
+        }
+        entry.pending = std::shared_future<VkPipeline>();
+    }
+    if (entry.pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_device, entry.pipeline, nullptr);
+        entry.pipeline = VK_NULL_HANDLE;
+    }
+}
+
+VkPipeline PipelineRegistry::GetOrCompile(const PipelineKey& key, const Compile& compile)
+{
+    std::shared_future<VkPipeline> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto entry = m_pipelines.find(key);
+        if (entry != m_pipelines.end()) {
+            if (!entry->second.pending.valid()) {
+                ++m_statistics.hits;
+                return entry->second.pipeline;
+            }
+            pending = entry->second.pending;
+        }
+    }
+    if (pending.valid()) {
+        // compiling on a worker already; wait for it rather than compiling the same state twice
+        pending.wait();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto entry = m_pipelines.find(key);
+        if (entry != m_pipelines.end()) {
+            try {
+                IsReady(entry->second);
+            }
+            catch (...) {
+                m_pipelines.erase(entry);
+                throw;
+            }
+            ++m_statistics.hits;
+            return entry->second.pipeline;
+        }
+    }
+
+    VkPipeline pipeline = CompileTimed(compile);
+    Entry superseded;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_statistics.compiles;
+        Entry& entry = m_pipelines[key];
+        if (entry.pending.valid()) {
+            // a worker was asked for the same state meanwhile; nobody has its pipeline yet
+            superseded.pending = entry.pending;
+            entry.pending = std::shared_future<VkPipeline>();
+        }
+        else if (entry.pipeline != VK_NULL_HANDLE) {
+            // another thread compiled the same state meanwhile and may already be using it
+            vkDestroyPipeline(m_device, pipeline, nullptr);
+            return entry.pipeline;
+        }
+        entry.pipeline = pipeline;
+    }
+    DestroyEntry(superseded);
+    return pipeline;
+}
+
+VkPipeline PipelineRegistry::Request(const PipelineKey& key, const Compile& compile)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto entry = m_pipelines.find(key);
+    if (entry == m_pipelines.end()) {
+        Entry& added = m_pipelines[key];
+        added.pending = std::async(std::launch::async, &PipelineRegistry::CompileOnWorker, this, compile).share();
+        ++m_workerCompiles;
+        ++m_statistics.compiles;
+        ++m_statistics.asyncCompiles;
+        ++m_statistics.fallbacks;
+        return VK_NULL_HANDLE;
+    }
+    bool ready;
+    try {
+        ready = IsReady(entry->second);
+    }
+    catch (...) {
+        m_pipelines.erase(entry);
+        throw;
+    }
+    if (!ready) {
+        ++m_statistics.fallbacks;
+        return VK_NULL_HANDLE;
+    }
+    ++m_statistics.hits;
+    return entry->second.pipeline;
+}
+
+void PipelineRegistry::WaitForCompiles() noexcept
+{
+    std::vector<std::shared_future<VkPipeline>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& entry : m_pipelines) {
+            if (entry.second.pending.valid()) {
+                pending.push_back(entry.second.pending);
+            }
+        }
+    }
+    for (const auto& compile : pending) {
+        compile.wait();
+    }
+}
+
+PipelineRegistryStatistics PipelineRegistry::GetStatistics() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_statistics;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <unordered_map>
+#include "PipelineCache.h"
+#include "PipelinePresets.h"
+
+// Everything that identifies a graphics pipeline. Shader modules and the pipeline layout are kept
+// by the context until it is destroyed, so their handles identify them for every renderer. The
+// render pass is not part of the key: the render passes that renderers create are compatible
+// whenever their colour formats are.
+struct PipelineKey {
+    VkShaderModule vertexShader = VK_NULL_HANDLE;
+    VkShaderModule fragmentShader = VK_NULL_HANDLE;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    PipelineState state;
+
+    bool operator==(const PipelineKey& other) const noexcept {
+        return vertexShader == other.vertexShader && fragmentShader == other.fragmentShader &&
+            layout == other.layout && colorFormat == other.colorFormat && state == other.state;
+    }
+};
+
+struct PipelineKeyHash {
+    size_t operator()(const PipelineKey& key) const noexcept;
+};
+
+// How often a pipeline was found, compiled, or stood in for by a fallback while it compiled
+struct PipelineRegistryStatistics {
+    uint64_t hits = 0;
+    uint64_t compiles = 0;
+    // the compiles that ran on a worker thread
+    uint64_t asyncCompiles = 0;
+    // Request calls that returned VK_NULL_HANDLE because the pipeline was still compiling
+    uint64_t fallbacks = 0;
+};
+
+// The context's graphics pipelines, one per PipelineKey, so that asking for state that already
+// has a pipeline costs a hash lookup rather than a vkCreateGraphicsPipelines call. Misses are
+// compiled by a function the caller supplies, either on the calling thread or on a worker thread
+// while the caller keeps drawing with a pipeline it already has. All compiles go through the
+// pipeline cache. The cache is saved by the worker that finishes the last running compile, so
+// the calling thread never waits for the file to be written, and again when it is destroyed.
+// May be used from several threads.
+class PipelineRegistry
+{
+public:
+    typedef std::function<VkPipeline()> Compile;
+
+    PipelineRegistry();
+    virtual ~PipelineRegistry() noexcept;
+
+    void Create(VkDevice device, PipelineCache& pipelineCache) noexcept;
+    // Waits for compiles that are still running, then destroys every pipeline.
+    void Destroy() noexcept;
+    // Returns key's pipeline, compiling it on this thread if it has not been compiled, and
+    // waiting for it if it is compiling on a worker.
+    VkPipeline GetOrCompile(const PipelineKey& key, const Compile& compile);
+    // Returns key's pipeline if it has been compiled. Otherwise starts compiling it on a worker
+    // thread, unless that has already been done, and returns VK_NULL_HANDLE. compile must stay
+    // valid until WaitForCompiles is called. Rethrows the exception of a compile that failed,
+    // after which the next call tries again.
+    VkPipeline Request(const PipelineKey& key, const Compile& compile);
+    // Waits for the compiles that are running; for whoever is about to invalidate compile functions.
+    void WaitForCompiles() noexcept;
+    PipelineRegistryStatistics GetStatistics() const;
+
+private:
+    struct Entry {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        // valid while a worker thread compiles the pipeline
+        std::shared_future<VkPipeline> pending;
+    };
+
+    VkPipeline CompileTimed(const Compile& compile);
+    VkPipeline CompileOnWorker(const Compile& compile);
+    bool IsReady(Entry& entry);
+    void DestroyEntry(Entry& entry) noexcept;
+
+    VkDevice m_device;
+    PipelineCache* m_pipelineCache;
+    mutable std::mutex m_mutex;
+    // serializes the pipeline cache's statistics and saves between compiles
+    std::mutex m_cacheMutex;
+    std::unordered_map<PipelineKey, Entry, PipelineKeyHash> m_pipelines;
+    // compiles started by Request that have not finished
+    uint32_t m_workerCompiles;
+    PipelineRegistryStatistics m_statistics;
+};
@@ -0,0 +1,128 @@
+#if defined(_WIN32)
+#define VK_USE_PLATFORM_WIN32_KHR
+#elif defined(__WXGTK__)
+#include <gtk/gtk.h>
+#ifdef GDK_WINDOWING_X11
+#include <gdk/gdkx.h>
+#include <X11/Xlib-xcb.h>
+#define VK_USE_PLATFORM_XCB_KHR
+#endif
+#ifdef GDK_WINDOWING_WAYLAND
+#include <gdk/gdkwayland.h>
+#define VK_USE_PLATFORM_WAYLAND_KHR
+#endif
+#endif
+#include "PlatformSurface.h"
+#include "VulkanException.h"
+
+#if defined(_WIN32)
+static VkWin32SurfaceCreateInfoKHR CreateWin32SurfaceCreateInfo(wxWindow* window) noexcept
+{
+    VkWin32SurfaceCreateInfoKHR sci = {};
+    sci.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
+    sci.hwnd = window->GetHWND();
+    sci.hinstance = GetModuleHandle(NULL);
+    return sci;
+}
+#elif defined(__WXGTK__)
+// The GdkWindow that the canvas's client area is drawn into, created if GTK has not done so yet
+static GdkWindow* GetDrawingWindow(wxWindow* window)
+{
+    GtkWidget* widget = static_cast<GtkWidget*>(window->GetHandle());
+    gtk_widget_realize(widget);
+    GdkWindow* gdkWindow = window->GTKGetDrawingWindow();
+    if (gdkWindow == nullptr) {
+        gdkWindow = gtk_widget_get_window(widget);
+    }
+    if (gdkWindow == nullptr) {
+        throw std::runtime_error("Programming Error:\nThe canvas has no GDK window to create a surface for.");
+    }
+    return gdkWindow;
+}
+
+#ifdef GDK_WINDOWING_X11
+static VkXcbSurfaceCreateInfoKHR CreateXcbSurfaceCreateInfo(GdkWindow* gdkWindow) noexcept
+{
+    VkXcbSurfaceCreateInfoKHR sci = {};
+    sci.sType = VK_STRUCTURE_TYPE_XCB_SURFACE_CREATE_INFO_KHR;
+    sci.connection = XGetXCBConnection(gdk_x11_display_get_xdisplay(gdk_window_get_display(gdkWindow)));
+    sci.window = static_cast<xcb_window_t>(gdk_x11_window_get_xid(gdkWindow));
+    return sci;
+}
+#endif
+
+#ifdef GDK_WINDOWING_WAYLAND
+static VkWaylandSurfaceCreateInfoKHR CreateWaylandSurfaceCreateInfo(GdkWindow* gdkWindow) noexcept
+{
+    VkWaylandSurfaceCreateInfoKHR sci = {};
+    sci.sType = VK_STRUCTURE_TYPE_WAYLAND_SURFACE_CREATE_INFO_KHR;
+    sci.display = gdk_wayland_display_get_wl_display(gdk_window_get_display(gdkWindow));
+    sci.surface = gdk_wayland_window_get_wl_surface(gdkWindow);
+    return sci;
+}
+#endif
+#endif
+
+std::vector<const char*> PlatformSurface::GetRequiredInstanceExtensions(wxWindow* window)
+{
+#if defined(_WIN32)
+    return { VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_WIN32_SURFACE_EXTENSION_NAME };
+#elif defined(__WXGTK__)
+    GdkDisplay* display = gtk_widget_get_display(static_cast<GtkWidget*>(window->GetHandle()));
+#ifdef GDK_WINDOWING_X11
+    if (GDK_IS_X11_DISPLAY(display)) {
+        return { VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_XCB_SURFACE_EXTENSION_NAME };
+    }
+#endif
+#ifdef GDK_WINDOWING_WAYLAND
+    if (GDK_IS_WAYLAND_DISPLAY(display)) {
+        return { VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_WAYLAND_SURFACE_EXTENSION_NAME };
+    }
+#endif
+    throw std::runtime_error("GTK is using a display that VulkanCanvas cannot create a surface for.");
+#else
+#error PlatformSurface only supports Win32 and wxGTK. Changes are required to support other windowing systems.
+#endif
+}
+
+VkSurfaceKHR PlatformSurface::Create(VkInstance instance, wxWindow* window)
+{
+    VkSurfaceKHR surface = VK_NULL_HANDLE;
+#if defined(_WIN32)
+    VkWin32SurfaceCreateInfoKHR sci = CreateWin32SurfaceCreateInfo(window);
+    VkResult err = vkCreateWin32SurfaceKHR(instance, &sci, nullptr, &surface);
+    if (err != VK_SUCCESS) {
+        throw VulkanException(err, "Cannot create a Win32 Vulkan surface:");
+    }
+    return surface;
+#elif defined(__WXGTK__)
+    GdkWindow* gdkWindow = GetDrawingWindow(window);
+#ifdef GDK_WINDOWING_X11
+    if (GDK_IS_X11_WINDOW(gdkWindow)) {
+        // GTK 3 draws child widgets into their toplevel's X window unless asked for one of their own
+        if (!gdk_window_ensure_native(gdkWindow)) {
+            throw std::runtime_error("Unable to create a native X11 window for the Vulkan canvas.");
+        }
+        VkXcbSurfaceCreateInfoKHR sci = CreateXcbSurfaceCreateInfo(gdkWindow);
+        VkResult err = vkCreateXcbSurfaceKHR(instance, &sci, nullptr, &surface);
+        if (err != VK_SUCCESS) {
+            throw VulkanException(err, "Cannot create an xcb Vulkan surface:");
+        }
+        return surface;
+    }
+#endif
+#ifdef GDK_WINDOWING_WAYLAND
+    if (GDK_IS_WAYLAND_WINDOW(gdkWindow)) {
+        // Wayland child windows are not native, so this is the toplevel's surface and the canvas
+        // should fill its frame; run with GDK_BACKEND=x11 otherwise
+        VkWaylandSurfaceCreateInfoKHR sci = CreateWaylandSurfaceCreateInfo(gdkWindow);
+        VkResult err = vkCreateWaylandSurfaceKHR(instance, &sci, nullptr, &surface);
+        if (err != VK_SUCCESS) {
+            throw VulkanException(err, "Cannot create a Wayland Vulkan surface:");
+        }
+        return surface;
+    }
+#endif
+    throw std::runtime_error("GTK is using a display that VulkanCanvas cannot create a surface for.");
+#endif
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include "wx/wx.h"
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// Creates window surfaces for the windowing system wxWidgets was built for: Win32 on Windows, and
+// xcb (through Xlib) or Wayland under wxGTK, chosen by the display GDK is using at run time.
+// The platform specific Vulkan headers are only included in PlatformSurface.cpp.
+class PlatformSurface
+{
+public:
+    // the instance extensions that Create needs for window
+    static std::vector<const char*> GetRequiredInstanceExtensions(wxWindow* window);
+    static VkSurfaceKHR Create(VkInstance instance, wxWindow* window);
+};
@@ -0,0 +1,35 @@
+#include "QueueSubmission.h"
+#include <algorithm>
+
+TimelineSubmit::TimelineSubmit()
+    : m_info({})
+{
+}
+
+void TimelineSubmit::Apply(VkSubmitInfo& submitInfo, const SubmitWaits& waits, const SubmitPoint& point)
+{
+    bool waitsOnTimeline = std::any_of(waits.values.begin(), waits.values.end(),
+        [](uint64_t value) { return value != 0; });
+    if (point.timeline == VK_NULL_HANDLE && !waitsOnTimeline) {
+        return;
+    }
+    m_signalSemaphores.assign(submitInfo.pSignalSemaphores,
+        submitInfo.pSignalSemaphores + submitInfo.signalSemaphoreCount);
+    m_signalValues.assign(m_signalSemaphores.size(), 0);
+    if (point.timeline != VK_NULL_HANDLE) {
+        m_signalSemaphores.push_back(point.timeline);
+        m_signalValues.push_back(point.value);
+    }
+
+    m_info = {};
+    m_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    m_info.pNext = submitInfo.pNext;
+    m_info.waitSemaphoreValueCount = static_cast<uint32_t>(waits.values.size());
+    m_info.pWaitSemaphoreValues = waits.values.data();
+    m_info.signalSemaphoreValueCount = static_cast<uint32_t>(m_signalValues.size());
+    m_info.pSignalSemaphoreValues = m_signalValues.data();
+
+    submitInfo.pNext = &m_info;
+    submitInfo.signalSemaphoreCount = static_cast<uint32_t>(m_signalSemaphores.size());
+    submitInfo.pSignalSemaphores = m_signalSemaphores.data();
+}
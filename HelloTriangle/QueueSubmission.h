@@ -0,0 +1,45 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <vector>
+
+// Where the CPU can wait for a queue submission to complete: a fence, or the value that the queue's
+// timeline semaphore reaches when the submission completes. A default constructed point has
+// nothing to wait for.
+struct SubmitPoint {
+    VkFence fence = VK_NULL_HANDLE;
+    VkSemaphore timeline = VK_NULL_HANDLE;
+    uint64_t value = 0;
+
+    bool IsNull() const noexcept { return fence == VK_NULL_HANDLE && timeline == VK_NULL_HANDLE; }
+};
+
+// Semaphores, and the stages at which they are waited on, that a queue submission must wait for
+struct SubmitWaits {
+    std::vector<VkSemaphore> semaphores;
+    std::vector<VkPipelineStageFlags> stages;
+    // the value to wait for on a timeline semaphore; ignored, and 0, for binary semaphores
+    std::vector<uint64_t> values;
+
+    void Add(VkSemaphore semaphore, VkPipelineStageFlags stage, uint64_t value = 0) {
+        semaphores.push_back(semaphore);
+        stages.push_back(stage);
+        values.push_back(value);
+    }
+};
+
+// The timeline semaphore values of one VkSubmitInfo. Apply adds the signal of a timeline submit
+// point to the submission and chains the values to it; it must stay where it is until the
+// submission has been made.
+class TimelineSubmit
+{
+public:
+    TimelineSubmit();
+
+    // Does nothing when neither waits nor point involve a timeline semaphore.
+    void Apply(VkSubmitInfo& submitInfo, const SubmitWaits& waits, const SubmitPoint& point);
+
+private:
+    std::vector<VkSemaphore> m_signalSemaphores;
+    std::vector<uint64_t> m_signalValues;
+    VkTimelineSemaphoreSubmitInfo m_info;
+};
@@ -0,0 +1,83 @@
+#include "RenderLoop.h"
+#include "VulkanCanvas.h"
+#include <algorithm>
+#include <stdexcept>
+
+RenderLoop::RenderLoop(VulkanCanvas* canvas)
+    : m_canvas(canvas), m_timer(this), m_mode(RenderLoopMode::PaintEvents), m_idleBound(false)
+{
+    Bind(wxEVT_TIMER, &RenderLoop::OnTimer, this);
+}
+
+
+RenderLoop::~RenderLoop()
+{
+    Stop();
+}
+
+void RenderLoop::SetMode(RenderLoopMode mode, double targetFrameRate)
+{
+    Stop();
+    if (mode == RenderLoopMode::DisplaySynced && m_mode != RenderLoopMode::DisplaySynced) {
+        m_savedPolicy = m_canvas->GetPresentationPolicy();
+        m_canvas->SetPresentationPolicy(PresentationPolicy::VSync());
+    }
+    else if (mode != RenderLoopMode::DisplaySynced && m_mode == RenderLoopMode::DisplaySynced) {
+        m_canvas->SetPresentationPolicy(m_savedPolicy);
+    }
+    m_mode = mode;
+    m_pacer.ResetStatistics();
+    m_pacer.SetTargetFrameRate(mode == RenderLoopMode::FixedRate ? targetFrameRate : 0.0);
+
+    m_canvas->SetRenderOnPaint(mode == RenderLoopMode::PaintEvents);
+    switch (mode) {
+    case RenderLoopMode::PaintEvents:
+        break;
+    case RenderLoopMode::TimerDriven:
+        if (targetFrameRate <= 0.0) {
+            throw std::runtime_error("Programming Error:\nA timer driven render loop needs a target frame rate.");
+        }
+        m_timer.Start(std::max(1, static_cast<int>(1000.0 / targetFrameRate + 0.5)));
+        break;
+    case RenderLoopMode::Unlimited:
+    case RenderLoopMode::FixedRate:
+    case RenderLoopMode::DisplaySynced:
+        m_canvas->Bind(wxEVT_IDLE, &RenderLoop::OnIdle, this);
+        m_idleBound = true;
+        break;
+    }
+}
+
+void RenderLoop::Stop()
+{
+    m_timer.Stop();
+    if (m_idleBound) {
+        m_canvas->Unbind(wxEVT_IDLE, &RenderLoop::OnIdle, this);
+        m_idleBound = false;
+    }
+}
+
+bool RenderLoop::RenderOneFrame()
+{
+    m_pacer.WaitForNextFrame();
+    if (!m_canvas->RenderFrame()) {
+        // the canvas has reported the error; don't keep failing every frame
+        Stop();
+        return false;
+    }
+    m_pacer.FrameCompleted();
+    return true;
+}
+
+void RenderLoop::OnIdle(wxIdleEvent& event)
+{
+    event.Skip();
+    if (RenderOneFrame()) {
+        event.RequestMore();
+    }
+}
+
+void RenderLoop::OnTimer(wxTimerEvent& event)
+{
+    RenderOneFrame();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include "wx/wx.h"
+#include "FramePacer.h"
+#include "VulkanCanvas.h"
+
+enum class RenderLoopMode {
+    PaintEvents,    // render only when wx delivers wxEVT_PAINT to the canvas
+    Unlimited,      // render from idle events as fast as possible
+    FixedRate,      // render from idle events, paced to the target frame rate
+    TimerDriven,    // render from a wxTimer firing at the target frame rate
+    DisplaySynced   // render from idle events and let a FIFO present block on vertical blank; see SetMode
+};
+
+// Decides when VulkanCanvas renders a frame and measures the time between frames.
+class RenderLoop :
+    public wxEvtHandler
+{
+public:
+    RenderLoop(VulkanCanvas* canvas);
+    virtual ~RenderLoop();
+
+    // DisplaySynced switches the canvas to PresentationPolicy::VSync, recreating its swapchain, and
+    // leaving DisplaySynced restores the policy the canvas had before.
+    void SetMode(RenderLoopMode mode, double targetFrameRate = 60.0);
+    RenderLoopMode GetMode() const noexcept { return m_mode; }
+    const FrameTimeStatistics& GetFrameTimeStatistics() const noexcept { return m_pacer.GetStatistics(); }
+
+private:
+    void OnIdle(wxIdleEvent& event);
+    void OnTimer(wxTimerEvent& event);
+    bool RenderOneFrame();
+    void Stop();
+
+    VulkanCanvas* m_canvas;
+    wxTimer m_timer;
+    FramePacer m_pacer;
+    RenderLoopMode m_mode;
+    bool m_idleBound;
+    // the canvas's policy from before DisplaySynced replaced it
+    PresentationPolicy m_savedPolicy;
+};
@@ -0,0 +1,160 @@
+#include "ShaderBinaryProvider.h"
+#include <sstream>
+#include <stdexcept>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef EMBEDDED_SHADERS
+// generated into the intermediate directory by the shader custom build steps
+#include "vert.spv.h"
+#include "frag.spv.h"
+#endif
+
+const uint32_t spirvMagicNumber = 0x07230203;
+
+ShaderBinaryProvider::~ShaderBinaryProvider()
+{
+}
+
+std::unique_ptr<ShaderBinaryProvider> ShaderBinaryProvider::Create()
+{
+#ifdef EMBEDDED_SHADERS
+    return std::unique_ptr<ShaderBinaryProvider>(new EmbeddedShaderProvider());
+#else
+    return std::unique_ptr<ShaderBinaryProvider>(new MappedFileShaderProvider());
+#endif
+}
+
+void ShaderBinaryProvider::ValidateShader(const std::string& name, const ShaderBinary& binary)
+{
+    if (binary.code == nullptr || binary.size < sizeof(uint32_t) || binary.size % sizeof(uint32_t) != 0
+        || binary.code[0] != spirvMagicNumber) {
+        std::stringstream ss;
+        ss << "Shader " << name << " does not contain valid SPIR-V code.";
+        throw std::runtime_error(ss.str());
+    }
+}
+
+#ifdef EMBEDDED_SHADERS
+ShaderBinary EmbeddedShaderProvider::GetShader(const std::string& name)
+{
+    ShaderBinary binary;
+    if (name == "vert.spv") {
+        binary.code = vertShaderCode;
+        binary.size = sizeof(vertShaderCode);
+    }
+    else if (name == "frag.spv") {
+        binary.code = fragShaderCode;
+        binary.size = sizeof(fragShaderCode);
+    }
+    else {
+        std::stringstream ss;
+        ss << "No embedded shader named " << name;
+        throw std::runtime_error(ss.str());
+    }
+    ValidateShader(name, binary);
+    return binary;
+}
+#endif
+
+MappedFileShaderProvider::MappedFileShaderProvider(const std::string& directory)
+    : m_directory(directory)
+{
+}
+
+
+MappedFileShaderProvider::~MappedFileShaderProvider()
+{
+    for (auto& file : m_files) {
+        UnmapFile(file.second);
+    }
+}
+
+ShaderBinary MappedFileShaderProvider::GetShader(const std::string& name)
+{
+    auto iter = m_files.find(name);
+    if (iter == m_files.end()) {
+        MappedFile file = MapFile(m_directory + name);
+        iter = m_files.insert({ name, file }).first;
+    }
+    ShaderBinary binary;
+    binary.code = static_cast<const uint32_t*>(iter->second.data);
+    binary.size = iter->second.size;
+    ValidateShader(name, binary);
+    return binary;
+}
+
+MappedFileShaderProvider::MappedFile MappedFileShaderProvider::MapFile(const std::string& fileName) const
+{
+    MappedFile file;
+    std::stringstream ss;
+    ss << "Failed to map file: " << fileName;
+#ifdef _WIN32
+    HANDLE fileHandle = ::CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (fileHandle == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error(ss.str());
+    }
+    LARGE_INTEGER fileSize;
+    if (!::GetFileSizeEx(fileHandle, &fileSize) || fileSize.QuadPart == 0) {
+        ::CloseHandle(fileHandle);
+        throw std::runtime_error(ss.str());
+    }
+    HANDLE mappingHandle = ::CreateFileMappingA(fileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle == nullptr) {
+        ::CloseHandle(fileHandle);
+        throw std::runtime_error(ss.str());
+    }
+    void* data = ::MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    if (data == nullptr) {
+        ::CloseHandle(mappingHandle);
+        ::CloseHandle(fileHandle);
+        throw std::runtime_error(ss.str());
+    }
+    file.data = data;
+    file.size = static_cast<size_t>(fileSize.QuadPart);
+    file.fileHandle = fileHandle;
+    file.mappingHandle = mappingHandle;
+#else
+    int fd = ::open(fileName.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(ss.str());
+    }
+    struct stat fileInfo;
+    if (::fstat(fd, &fileInfo) != 0 || fileInfo.st_size == 0) {
+        ::close(fd);
+        throw std::runtime_error(ss.str());
+    }
+    void* data = ::mmap(nullptr, static_cast<size_t>(fileInfo.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error(ss.str());
+    }
+    file.data = data;
+    file.size = static_cast<size_t>(fileInfo.st_size);
+#endif
+    return file;
+}
+
+void MappedFileShaderProvider::UnmapFile(MappedFile& file) noexcept
+{
+    if (file.data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    ::UnmapViewOfFile(file.data);
+    ::CloseHandle(file.mappingHandle);
+    ::CloseHandle(file.fileHandle);
+#else
+    ::munmap(file.data, file.size);
+#endif
+    file.data = nullptr;
+}
@@ -0,0 +1,64 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+
+// SPIR-V code for one shader. The code is owned by the provider that returned it
+// and stays valid until the provider is destroyed.
+struct ShaderBinary {
+    const uint32_t* code = nullptr;
+    size_t size = 0;
+};
+
+class ShaderBinaryProvider
+{
+public:
+    virtual ~ShaderBinaryProvider();
+    virtual ShaderBinary GetShader(const std::string& name) = 0;
+
+    // The embedded provider when the shaders were compiled into the executable,
+    // otherwise a provider that maps the .spv files from the working directory.
+    static std::unique_ptr<ShaderBinaryProvider> Create();
+
+protected:
+    static void ValidateShader(const std::string& name, const ShaderBinary& binary);
+};
+
+#ifdef EMBEDDED_SHADERS
+// Serves the uint32_t arrays generated by glslangValidator --vn at build time.
+class EmbeddedShaderProvider :
+    public ShaderBinaryProvider
+{
+public:
+    virtual ShaderBinary GetShader(const std::string& name) override;
+};
+#endif
+
+// Memory-maps .spv files. The mapping is page aligned, so the SPIR-V is used in place
+// without being copied.
+class MappedFileShaderProvider :
+    public ShaderBinaryProvider
+{
+public:
+    MappedFileShaderProvider(const std::string& directory = "");
+    virtual ~MappedFileShaderProvider();
+    virtual ShaderBinary GetShader(const std::string& name) override;
+
+private:
+    struct MappedFile {
+        void* data = nullptr;
+        size_t size = 0;
+#ifdef _WIN32
+        void* fileHandle = nullptr;
+        void* mappingHandle = nullptr;
+#endif
+    };
+
+    MappedFile MapFile(const std::string& fileName) const;
+    static void UnmapFile(MappedFile& file) noexcept;
+
+    std::string m_directory;
+    std::map<std::string, MappedFile> m_files;
+};
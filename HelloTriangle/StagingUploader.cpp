@@ -0,0 +1,389 @@
+#include "StagingUploader.h"
+#include "VulkanContext.h"
+#include "VulkanException.h"
+#include <algorithm>
+#include <cstring>
+
+// copies out of the ring start on this boundary
+const VkDeviceSize stagingAlignment = 16;
+
+StagingUploader::StagingUploader(VkDeviceSize ringSize)
+    : m_context(nullptr), m_device(VK_NULL_HANDLE), m_allocator(nullptr), m_transferQueue(VK_NULL_HANDLE),
+    m_transferFamily(0), m_graphicsFamily(0), m_commandPool(VK_NULL_HANDLE), m_ringSize(ringSize),
+    m_ringHead(0), m_ringTail(0), m_ringUsed(0), m_recording(false)
+{
+}
+
+
+StagingUploader::~StagingUploader() noexcept
+{
+    Destroy();
+}
+
+VkCommandPoolCreateInfo StagingUploader::CreateCommandPoolCreateInfo() const noexcept
+{
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_transferFamily;
+    return poolInfo;
+}
+
+void StagingUploader::Create(VulkanContext& context, VkQueue transferQueue, uint32_t transferFamily,
+    uint32_t graphicsFamily)
+{
+    Destroy();
+    m_context = &context;
+    m_device = context.GetDevice();
+    m_allocator = &context.GetMemoryAllocator();
+    m_transferQueue = transferQueue;
+    m_transferFamily = transferFamily;
+    m_graphicsFamily = graphicsFamily;
+
+    VkCommandPoolCreateInfo poolInfo = CreateCommandPoolCreateInfo();
+    VkResult result = vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to create the transfer command pool:");
+    }
+    m_ring = m_allocator->CreateBuffer(m_ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    m_ringHead = 0;
+    m_ringTail = 0;
+    m_ringUsed = 0;
+}
+
+void StagingUploader::Destroy() noexcept
+{
+    if (m_device == VK_NULL_HANDLE) {
+        return;
+    }
+    vkQueueWaitIdle(m_transferQueue);
+    if (m_recording) {
+        DestroyBatch(m_current);
+        m_recording = false;
+    }
+    for (auto& batch : m_submitted) {
+        DestroyBatch(batch);
+    }
+    m_submitted.clear();
+    for (auto& batch : m_freeBatches) {
+        DestroyBatch(batch);
+    }
+    m_freeBatches.clear();
+    if (m_commandPool != VK_NULL_HANDLE) {
+        vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+        m_commandPool = VK_NULL_HANDLE;
+    }
+    m_allocator->DestroyBuffer(m_ring);
+    m_device = VK_NULL_HANDLE;
+}
+
+StagingUploader::Batch StagingUploader::CreateBatch()
+{
+    Batch batch;
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = m_commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VkResult result = vkAllocateCommandBuffers(m_device, &allocInfo, &batch.commandBuffer);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to allocate a transfer command buffer:");
+    }
+    if (m_context->UsesTimelineSemaphores()) {
+        // the transfer queue's timeline takes the place of both
+        return batch;
+    }
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    result = vkCreateFence(m_device, &fenceInfo, nullptr, &batch.fence);
+    if (result != VK_SUCCESS) {
+        DestroyBatch(batch);
+        throw VulkanException(result, "Failed to create a transfer fence:");
+    }
+    if (UsesDedicatedTransferQueue()) {
+        VkSemaphoreCreateInfo semaphoreInfo = {};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        result = vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &batch.semaphore);
+        if (result != VK_SUCCESS) {
+            DestroyBatch(batch);
+            throw VulkanException(result, "Failed to create a transfer semaphore:");
+        }
+    }
+    return batch;
+}
+
+void StagingUploader::DestroyBatch(Batch& batch) noexcept
+{
+    if (batch.commandBuffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(m_device, m_commandPool, 1, &batch.commandBuffer);
+    }
+    if (batch.fence != VK_NULL_HANDLE) {
+        vkDestroyFence(m_device, batch.fence, nullptr);
+    }
+    if (batch.semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(m_device, batch.semaphore, nullptr);
+    }
+    batch = Batch();
+}
+
+StagingUploader::Batch& StagingUploader::CurrentBatch()
+{
+    if (m_recording) {
+        return m_current;
+    }
+    if (m_freeBatches.empty()) {
+        m_current = CreateBatch();
+    }
+    else {
+        m_current = m_freeBatches.back();
+        m_freeBatches.pop_back();
+    }
+    m_current.releaseBarriers.clear();
+    m_current.acquireBarriers.clear();
+    m_current.dstStages = 0;
+    m_current.ringBytes = 0;
+    m_current.ringReleased = false;
+    m_current.acquired = false;
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VkResult result = vkBeginCommandBuffer(m_current.commandBuffer, &beginInfo);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to begin recording a transfer command buffer:");
+    }
+    m_recording = true;
+    return m_current;
+}
+
+void StagingUploader::RetireBatches(bool waitForOldest)
+{
+    if (waitForOldest) {
+        auto oldest = std::find_if(m_submitted.begin(), m_submitted.end(),
+            [](const Batch& batch) { return !batch.ringReleased; });
+        if (oldest != m_submitted.end()) {
+            VkResult result = m_context->Wait(oldest->submitted);
+            if (result != VK_SUCCESS) {
+                throw VulkanException(result, "Failed to wait for a transfer batch:");
+            }
+        }
+    }
+    // batches complete in submission order, so stop at the first one still running
+    for (auto& batch : m_submitted) {
+        if (batch.ringReleased) {
+            continue;
+        }
+        if (!m_context->IsComplete(batch.submitted)) {
+            break;
+        }
+        m_ringUsed -= batch.ringBytes;
+        m_ringTail = batch.ringEnd;
+        batch.ringReleased = true;
+    }
+    if (m_ringUsed == 0 && !m_recording) {
+        m_ringHead = 0;
+        m_ringTail = 0;
+    }
+    // a batch's binary semaphore can only be signaled again once the graphics queue has waited on it
+    while (!m_submitted.empty() && m_submitted.front().ringReleased && m_submitted.front().acquired) {
+        m_freeBatches.push_back(m_submitted.front());
+        m_submitted.pop_front();
+    }
+}
+
+VkDeviceSize StagingUploader::ReserveRingSpace(VkDeviceSize size, VkDeviceSize& reserved)
+{
+    size = (size + stagingAlignment - 1) / stagingAlignment * stagingAlignment;
+    size = std::min(size, m_ringSize);
+    for (;;) {
+        bool wrapped = m_ringHead < m_ringTail || (m_ringUsed > 0 && m_ringHead == m_ringTail);
+        if (!wrapped) {
+            // free space is [head, end) followed by [0, tail)
+            if (m_ringHead + size <= m_ringSize) {
+                VkDeviceSize offset = m_ringHead;
+                m_ringHead += size;
+                m_ringUsed += size;
+                reserved = size;
+                return offset;
+            }
+            if (size <= m_ringTail) {
+                // the space left at the end is skipped and freed with this allocation
+                reserved = m_ringSize - m_ringHead + size;
+                m_ringUsed += reserved;
+                m_ringHead = size;
+                return 0;
+            }
+        }
+        else if (m_ringHead + size <= m_ringTail) {
+            VkDeviceSize offset = m_ringHead;
+            m_ringHead += size;
+            m_ringUsed += size;
+            reserved = size;
+            return offset;
+        }
+        // everything still in the ring may belong to the batch being recorded
+        bool pendingInRing = std::any_of(m_submitted.begin(), m_submitted.end(),
+            [](const Batch& batch) { return !batch.ringReleased; });
+        if (!pendingInRing) {
+            Flush();
+        }
+        ++m_statistics.ringStallCount;
+        RetireBatches(true);
+    }
+}
+
+VkBufferMemoryBarrier StagingUploader::CreateBufferBarrier(VkBuffer buffer, VkDeviceSize offset,
+    VkDeviceSize size, VkAccessFlags srcAccess, VkAccessFlags dstAccess) const noexcept
+{
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+    if (UsesDedicatedTransferQueue()) {
+        barrier.srcQueueFamilyIndex = m_transferFamily;
+        barrier.dstQueueFamilyIndex = m_graphicsFamily;
+    }
+    else {
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    }
+    barrier.buffer = buffer;
+    barrier.offset = offset;
+    barrier.size = size;
+    return barrier;
+}
+
+void StagingUploader::Upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+    VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    ++m_statistics.uploadCount;
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        VkDeviceSize chunk = std::min(size, m_ringSize);
+        // reserve first: making room may flush the batch being recorded
+        VkDeviceSize reserved = 0;
+        VkDeviceSize ringOffset = ReserveRingSpace(chunk, reserved);
+        std::memcpy(static_cast<char*>(m_ring.allocation.mappedData) + ringOffset, bytes, static_cast<size_t>(chunk));
+
+        Batch& batch = CurrentBatch();
+        VkBufferCopy region = { ringOffset, dstOffset, chunk };
+        vkCmdCopyBuffer(batch.commandBuffer, m_ring.buffer, dstBuffer, 1, &region);
+        if (UsesDedicatedTransferQueue()) {
+            // the release half of the ownership transfer; the destination access is ignored here
+            batch.releaseBarriers.push_back(CreateBufferBarrier(dstBuffer, dstOffset, chunk,
+                VK_ACCESS_TRANSFER_WRITE_BIT, 0));
+            batch.acquireBarriers.push_back(CreateBufferBarrier(dstBuffer, dstOffset, chunk, 0, dstAccess));
+        }
+        else {
+            batch.releaseBarriers.push_back(CreateBufferBarrier(dstBuffer, dstOffset, chunk,
+                VK_ACCESS_TRANSFER_WRITE_BIT, dstAccess));
+        }
+        batch.dstStages |= dstStage;
+        batch.ringEnd = m_ringHead;
+        batch.ringBytes += reserved;
+
+        m_statistics.bytesUploaded += chunk;
+        bytes += chunk;
+        dstOffset += chunk;
+        size -= chunk;
+    }
+}
+
+void StagingUploader::Flush()
+{
+    if (!m_recording) {
+        return;
+    }
+    Batch& batch = m_current;
+    // on the same queue this barrier alone makes the copies visible to later graphics work;
+    // on a transfer queue it releases ownership and the graphics queue acquires it
+    VkPipelineStageFlags dstStages = UsesDedicatedTransferQueue() ?
+        VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : batch.dstStages;
+    vkCmdPipelineBarrier(batch.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, dstStages, 0, 0, nullptr,
+        static_cast<uint32_t>(batch.releaseBarriers.size()), batch.releaseBarriers.data(), 0, nullptr);
+    VkResult result = vkEndCommandBuffer(batch.commandBuffer);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to record a transfer command buffer:");
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &batch.commandBuffer;
+    if (batch.semaphore != VK_NULL_HANDLE) {
+        submitInfo.signalSemaphoreCount = 1;
+        submitInfo.pSignalSemaphores = &batch.semaphore;
+    }
+    SubmitPoint point = m_context->BeginSubmit(m_transferQueue, batch.fence);
+    SubmitWaits noWaits;
+    TimelineSubmit timelineSubmit;
+    timelineSubmit.Apply(submitInfo, noWaits, point);
+    result = vkQueueSubmit(m_transferQueue, 1, &submitInfo, point.fence);
+    if (result != VK_SUCCESS) {
+        m_context->CancelSubmit(m_transferQueue, point);
+        throw VulkanException(result, "Failed to submit a transfer batch:");
+    }
+    batch.submitted = point;
+    // on the graphics queue there is nothing to acquire
+    batch.acquired = !UsesDedicatedTransferQueue();
+    m_submitted.push_back(batch);
+    m_recording = false;
+    ++m_statistics.batchCount;
+}
+
+bool StagingUploader::RecordAcquire(VkCommandBuffer graphicsCommandBuffer, SubmitWaits& waits)
+{
+    Flush();
+    std::vector<VkBufferMemoryBarrier> barriers;
+    VkPipelineStageFlags stages = 0;
+    bool acquired = false;
+    for (auto& batch : m_submitted) {
+        if (batch.acquired) {
+            continue;
+        }
+        barriers.insert(barriers.end(), batch.acquireBarriers.begin(), batch.acquireBarriers.end());
+        stages |= batch.dstStages;
+        if (batch.submitted.timeline != VK_NULL_HANDLE) {
+            waits.Add(batch.submitted.timeline, batch.dstStages, batch.submitted.value);
+        }
+        else {
+            waits.Add(batch.semaphore, batch.dstStages);
+        }
+        batch.acquired = true;
+        acquired = true;
+    }
+    if (!barriers.empty()) {
+        vkCmdPipelineBarrier(graphicsCommandBuffer, stages, stages, 0, 0, nullptr,
+            static_cast<uint32_t>(barriers.size()), barriers.data(), 0, nullptr);
+    }
+    RetireBatches(false);
+    return acquired;
+}
+
+void StagingUploader::WaitIdle()
+{
+    Flush();
+    VkResult result = vkQueueWaitIdle(m_transferQueue);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed waiting for the transfer queue to become idle:");
+    }
+    RetireBatches(false);
+}
+
+std::vector<SubmitPoint> StagingUploader::Discard(VkBuffer buffer)
+{
+    Flush();
+    auto writesBuffer = [buffer](const VkBufferMemoryBarrier& barrier) { return barrier.buffer == buffer; };
+    std::vector<SubmitPoint> copies;
+    for (auto& batch : m_submitted) {
+        // every copy has a release barrier, even on the graphics queue
+        if (!batch.ringReleased && std::any_of(batch.releaseBarriers.begin(), batch.releaseBarriers.end(),
+            writesBuffer)) {
+            copies.push_back(batch.submitted);
+        }
+        batch.acquireBarriers.erase(std::remove_if(batch.acquireBarriers.begin(), batch.acquireBarriers.end(),
+            writesBuffer), batch.acquireBarriers.end());
+    }
+    return copies;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "DeviceMemoryAllocator.h"
+#include "QueueSubmission.h"
+#include <deque>
+#include <vector>
+
+class VulkanContext;
+
+struct StagingStatistics {
+    uint64_t uploadCount = 0;
+    uint64_t batchCount = 0;
+    VkDeviceSize bytesUploaded = 0;
+    // times Upload had to wait for an earlier batch to free space in the ring
+    uint64_t ringStallCount = 0;
+};
+
+// Copies data into device-local buffers through a persistently mapped staging ring. Copies are
+// batched into command buffers for a dedicated transfer queue family when the device has one,
+// so uploads run alongside rendering rather than in front of it on the graphics queue.
+//
+// When the transfer family differs from the graphics family, ownership of each destination
+// buffer is released by the transfer queue and acquired by the graphics queue: the batch signals
+// a semaphore, and RecordAcquire records the matching acquire barriers into the next frame's
+// command buffer and adds the semaphore to that frame's submission. When the context uses
+// timeline semaphores, each batch instead signals a value on the transfer queue's timeline, which
+// the frame waits for and the uploader polls, so batches need neither a fence nor a semaphore.
+class StagingUploader
+{
+public:
+    static const VkDeviceSize DEFAULT_RING_SIZE = 16 * 1024 * 1024;
+
+    StagingUploader(VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+    virtual ~StagingUploader() noexcept;
+
+    void Create(VulkanContext& context, VkQueue transferQueue, uint32_t transferFamily, uint32_t graphicsFamily);
+    void Destroy() noexcept;
+
+    // Queues a copy into dstBuffer. The data is consumed by the graphics queue at dstStage with
+    // dstAccess. Uploads larger than the ring are split across several batches.
+    void Upload(VkBuffer dstBuffer, VkDeviceSize dstOffset, const void* data, VkDeviceSize size,
+        VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+    // Submits the queued copies to the transfer queue.
+    void Flush();
+    // Flushes, then records what the graphics queue needs before it can use the uploaded data.
+    // Returns true if any upload was acquired; such a command buffer must not be submitted twice.
+    bool RecordAcquire(VkCommandBuffer graphicsCommandBuffer, SubmitWaits& waits);
+    void WaitIdle();
+    // Submits any copies into buffer that are still being recorded and drops its pending acquire,
+    // so that the buffer can be destroyed before a frame has taken ownership of it. Returns where
+    // the submitted copies into buffer complete; the buffer must stay alive until then.
+    std::vector<SubmitPoint> Discard(VkBuffer buffer);
+    bool UsesDedicatedTransferQueue() const noexcept { return m_transferFamily != m_graphicsFamily; }
+    const StagingStatistics& GetStatistics() const noexcept { return m_statistics; }
+
+private:
+    struct Batch {
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        // without timeline semaphores; the semaphore only with a dedicated transfer queue
+        VkFence fence = VK_NULL_HANDLE;
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        SubmitPoint submitted;
+        // where this batch's staging data ends, and how much of the ring it holds
+        VkDeviceSize ringEnd = 0;
+        VkDeviceSize ringBytes = 0;
+        std::vector<VkBufferMemoryBarrier> releaseBarriers;
+        std::vector<VkBufferMemoryBarrier> acquireBarriers;
+        VkPipelineStageFlags dstStages = 0;
+        bool ringReleased = false;
+        bool acquired = false;
+    };
+
+    VkCommandPoolCreateInfo CreateCommandPoolCreateInfo() const noexcept;
+    VkBufferMemoryBarrier CreateBufferBarrier(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize size,
+        VkAccessFlags srcAccess, VkAccessFlags dstAccess) const noexcept;
+    Batch& CurrentBatch();
+    Batch CreateBatch();
+    VkDeviceSize ReserveRingSpace(VkDeviceSize size, VkDeviceSize& reserved);
+    void RetireBatches(bool waitForOldest);
+    void DestroyBatch(Batch& batch) noexcept;
+
+    VulkanContext* m_context;
+    VkDevice m_device;
+    DeviceMemoryAllocator* m_allocator;
+    VkQueue m_transferQueue;
+    uint32_t m_transferFamily;
+    uint32_t m_graphicsFamily;
+    VkCommandPool m_commandPool;
+    AllocatedBuffer m_ring;
+    VkDeviceSize m_ringSize;
+    VkDeviceSize m_ringHead;
+    VkDeviceSize m_ringTail;
+    VkDeviceSize m_ringUsed;
+    Batch m_current;
+    bool m_recording;
+    // submitted batches, oldest first
+    std::deque<Batch> m_submitted;
+    std::vector<Batch> m_freeBatches;
+    StagingStatistics m_statistics;
+};
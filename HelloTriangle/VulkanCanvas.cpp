@@ -1,243 +1,140 @@
 #include "VulkanCanvas.h"
+#include "FrameCoordinator.h"
+#include "PlatformSurface.h"
 #include "VulkanException.h"
 #include "wxVulkanTutorialApp.h"
 #include <vulkan/vulkan.h>
-#include <fstream>
 #include <sstream>
-
-
-#pragma comment(lib, "vulkan-1.lib")
-
-const std::vector<const char*> validationLayers = {
-    "VK_LAYER_LUNARG_standard_validation"
-};
+#include <limits>
+#include <algorithm>
 
 const std::vector<const char*> deviceExtensions = {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
 };
 
-#ifdef _DEBUG
-const bool enableValidationLayers = true;
-#else
-const bool enableValidationLayers = false;
-#endif
+PresentationPolicy PresentationPolicy::Default()
+{
+    PresentationPolicy policy;
+    policy.presentModes = { VK_PRESENT_MODE_MAILBOX_KHR };
+    return policy;
+}
+
+PresentationPolicy PresentationPolicy::LowLatency()
+{
+    PresentationPolicy policy;
+    // MAILBOX replaces a queued image rather than waiting behind it; IMMEDIATE may tear but adds no queueing
+    policy.presentModes = { VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR,
+        VK_PRESENT_MODE_FIFO_RELAXED_KHR };
+    policy.imageCount = 2;
+    return policy;
+}
+
+PresentationPolicy PresentationPolicy::MaxThroughput()
+{
+    PresentationPolicy policy;
+    policy.presentModes = { VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR };
+    policy.imageCount = 4;
+    return policy;
+}
+
+PresentationPolicy PresentationPolicy::VSync()
+{
+    PresentationPolicy policy;
+    policy.presentModes = { VK_PRESENT_MODE_FIFO_KHR };
+    policy.imageCount = 3;
+    return policy;
+}
 
 VulkanCanvas::VulkanCanvas(wxWindow *pParent,
     wxWindowID id,
     const wxPoint& pos,
     const wxSize& size,
     long style,
-    const wxString& name)
-    : wxWindow(pParent, id, pos, size, style, name),
-    m_vulkanInitialized(false), m_instance(VK_NULL_HANDLE),
-    m_surface(VK_NULL_HANDLE), m_physicalDevice(VK_NULL_HANDLE),
-    m_logicalDevice(VK_NULL_HANDLE), m_swapchain(VK_NULL_HANDLE),
-    m_renderPass(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE),
-    m_graphicsPipeline(VK_NULL_HANDLE), m_commandPool(VK_NULL_HANDLE),
-    m_imageAvailableSemaphore(VK_NULL_HANDLE), m_renderFinishedSemaphore(VK_NULL_HANDLE)
-{
+    const wxString& name,
+    std::shared_ptr<VulkanContext> context)
+    : wxWindow(pParent, id, pos, size, style, name), VulkanRenderer(context),
+    m_swapchain(VK_NULL_HANDLE), m_presentationPolicy(PresentationPolicy::Default()),
+    m_surfaceFormat({ VK_FORMAT_UNDEFINED, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR }),
+    m_presentMode(VK_PRESENT_MODE_FIFO_KHR), m_renderOnPaint(true), m_coordinator(nullptr)
+{
+    // everything in the client area is drawn by Vulkan
+    SetBackgroundStyle(wxBG_STYLE_PAINT);
     Bind(wxEVT_PAINT, &VulkanCanvas::OnPaint, this);
     Bind(wxEVT_SIZE, &VulkanCanvas::OnResize, this);
-    std::vector<const char*> requiredExtensions = { "VK_KHR_surface", "VK_KHR_win32_surface" };
-    InitializeVulkan(requiredExtensions);
-    VkApplicationInfo appInfo = CreateApplicationInfo("VulkanApp1");
-    std::vector<const char*> layerNames;
-	if (enableValidationLayers) {
-		layerNames = validationLayers;
-	}
-    VkInstanceCreateInfo createInfo = CreateInstanceCreateInfo(appInfo, requiredExtensions, layerNames);
-    CreateInstance(createInfo);
-    CreateWindowSurface();
-    PickPhysicalDevice();
-    CreateLogicalDevice();
-    CreateSwapChain(size);
-    CreateImageViews();
-    CreateRenderPass();
-    CreateGraphicsPipeline("vert.spv", "frag.spv");
-    CreateFrameBuffers();
-    CreateCommandPool();
-    CreateCommandBuffers();
-    CreateSemaphores();
+    std::vector<const char*> requiredExtensions = PlatformSurface::GetRequiredInstanceExtensions(this);
+    m_deviceExtensions = deviceExtensions;
+    // Shader loading, pipeline cache loading and pipeline compilation run on worker threads
+    // while the surface, device and swapchain objects are created here on the UI thread.
+    typedef InitScheduler::Thread Thread;
+    InitScheduler scheduler;
+    std::vector<std::string> pipelineDependencies = { "CreateRenderPass", "CreateDescriptorSetLayout" };
+    if (!m_context->IsDeviceCreated()) {
+        scheduler.Add("LoadShaders", Thread::Worker, [&] { LoadShaders({ "vert.spv", "frag.spv" }); });
+        scheduler.Add("CreateInstance", Thread::Caller,
+            [&] { InitializeInstance("VulkanApp1", requiredExtensions); });
+        scheduler.Add("CreateWindowSurface", Thread::Caller, [&] { CreateWindowSurface(); });
+        scheduler.Add("PickPhysicalDevice", Thread::Caller, [&] { PickPhysicalDevice(); });
+        scheduler.Add("CreateLogicalDevice", Thread::Caller, [&] { CreateLogicalDevice(); });
+        scheduler.Add("CreatePipelineCache", Thread::Worker, [&] { CreatePipelineCache(); },
+            { "CreateLogicalDevice" });
+        scheduler.Add("CreateMemoryAllocator", Thread::Caller, [&] { CreateMemoryAllocator(); });
+        pipelineDependencies.push_back("LoadShaders");
+        pipelineDependencies.push_back("CreatePipelineCache");
+    }
+    else {
+        // another canvas has created the instance, device, pipeline cache and shader modules
+        scheduler.Add("AttachContext", Thread::Caller, [&] { AttachContext(requiredExtensions); });
+        scheduler.Add("CreateWindowSurface", Thread::Caller, [&] { CreateWindowSurface(); });
+        scheduler.Add("SelectPresentQueue", Thread::Caller, [&] { SelectPresentQueue(); });
+    }
+    scheduler.Add("CreateStagingUploader", Thread::Caller, [&] { CreateStagingUploader(); });
+    // the render pass only needs the surface format, not the swapchain itself
+    scheduler.Add("ChooseSurfaceFormat", Thread::Caller, [&] { ChooseSurfaceFormat(); });
+    scheduler.Add("CreateRenderPass", Thread::Caller, [&] { CreateRenderPass(); });
+    scheduler.Add("CreateDescriptorSetLayout", Thread::Caller, [&] { CreateDescriptorSetLayout(); });
+    scheduler.Add("CreateGraphicsPipeline", Thread::Worker,
+        [&] { CreateGraphicsPipeline("vert.spv", "frag.spv"); }, pipelineDependencies);
+    scheduler.Add("CreateSwapChain", Thread::Caller, [&] { CreateSwapChain(size); });
+    scheduler.Add("CreateImageViews", Thread::Caller, [&] { CreateImageViews(); });
+    scheduler.Add("CreateFrameBuffers", Thread::Caller, [&] { CreateFrameBuffers(); });
+    scheduler.Add("CreateCommandBuffers", Thread::Caller, [&] { CreateCommandBuffers(); });
+    scheduler.Add("CreateSyncObjects", Thread::Caller, [&] { CreateSyncObjects(); });
+    scheduler.Add("CreateTimestampQueries", Thread::Caller, [&] { CreateTimestampQueries(); });
+    scheduler.Add("CreateMeshBuffers", Thread::Caller, [&] { CreateMeshBuffers(); });
+    scheduler.Add("CreateFrameArena", Thread::Caller, [&] { CreateFrameArena(); });
+    scheduler.Add("CreateDescriptorSets", Thread::Caller, [&] { CreateDescriptorSets(); });
+    RunInitSteps(scheduler);
 }
 
 
 VulkanCanvas::~VulkanCanvas() noexcept
 {
+    if (m_coordinator != nullptr) {
+        m_coordinator->RemoveCanvas(this);
+    }
+    // the swapchain and surface must go before the context destroys the device and instance
     if (m_instance != VK_NULL_HANDLE) {
         if (m_logicalDevice != VK_NULL_HANDLE) {
-            vkDeviceWaitIdle(m_logicalDevice);
-            if (m_graphicsPipeline != VK_NULL_HANDLE) {
-                vkDestroyPipeline(m_logicalDevice, m_graphicsPipeline, nullptr);
-            }
-            if (m_pipelineLayout != VK_NULL_HANDLE) {
-                vkDestroyPipelineLayout(m_logicalDevice, m_pipelineLayout, nullptr);
-            }
-            if (m_renderPass != VK_NULL_HANDLE) {
-                vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
-            }
+            m_context->Wait(GetFramesInFlight());
+            m_deletionQueue.Flush();
+            DestroyFrameBuffers();
+            DestroyImageViews();
             if (m_swapchain != VK_NULL_HANDLE) {
                 vkDestroySwapchainKHR(m_logicalDevice, m_swapchain, nullptr);
             }
-            for (auto& imageView : m_swapchainImageViews) {
-                vkDestroyImageView(m_logicalDevice, imageView, nullptr);
-            }
-            for (auto& framebuffer : m_swapchainFramebuffers) {
-                vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
-            }
-            if (m_commandPool != VK_NULL_HANDLE) {
-                vkDestroyCommandPool(m_logicalDevice, m_commandPool, nullptr);
-            }
-            if (m_imageAvailableSemaphore != VK_NULL_HANDLE) {
-                vkDestroySemaphore(m_logicalDevice, m_imageAvailableSemaphore, nullptr);
-            }
-            if (m_renderFinishedSemaphore != VK_NULL_HANDLE) {
-                vkDestroySemaphore(m_logicalDevice, m_renderFinishedSemaphore, nullptr);
-            }
-            vkDestroyDevice(m_logicalDevice, nullptr);
         }
         vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
-        vkDestroyInstance(m_instance, nullptr);
+        m_surface = VK_NULL_HANDLE;
     }
 }
 
-void VulkanCanvas::InitializeVulkan(std::vector<const char*> requiredExtensions)
-{
-    // make sure that the Vulkan library is available on this system
-#ifdef _WIN32
-    HMODULE vulkanModule = ::LoadLibraryA("vulkan-1.dll");
-    if (vulkanModule == NULL) {
-        throw std::runtime_error("Vulkan library is not available on this system, so program cannot run.\n"
-            "You must install the appropriate Vulkan library and also have a graphics card that supports Vulkan.");
-    }
-#else
-#error Only Win32 is currently supported. To see how to support other windowing systems, \
- see the definition of _glfw_dlopen in XXX_platform.h and its use in vulkan.c in the glfw\
- source code. XXX specifies the windowing system (e.g. x11 for X11, and wl for Wayland).
-#endif
-    // make sure that the correct extensions are available
-    uint32_t count;
-    VkResult err = vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
-    if (err != VK_SUCCESS) {
-        throw VulkanException(err, "Failed to retrieve the instance extension properties:");
-    }
-    std::vector<VkExtensionProperties> extensions(count);
-    err = vkEnumerateInstanceExtensionProperties(nullptr, &count, extensions.data());
-    if (err != VK_SUCCESS) {
-        throw VulkanException(err, "Failed to retrieve the instance extension properties:");
-    }
-    for(int extNum = 0; extNum < extensions.size(); ++extNum) {
-        for (auto& iter = requiredExtensions.begin(); iter < requiredExtensions.end(); ++iter) {
-            if (std::string(*iter) == extensions[extNum].extensionName) {
-                requiredExtensions.erase(iter);
-                break;
-            }
-        }
-    };
-    if (!requiredExtensions.empty()) {
-        std::stringstream ss;
-        ss << "The following required Vulkan extensions could not be found:\n";
-        for (int extNum = 0; extNum < requiredExtensions.size(); ++extNum) {
-            ss << requiredExtensions[extNum] << "\n";
-        }
-        ss << "Program cannot continue.";
-        throw std::runtime_error(ss.str());
-    }
-
-    m_vulkanInitialized = true;
-}
-
-VkApplicationInfo VulkanCanvas::CreateApplicationInfo(const std::string& appName,
-    const int32_t appVersion,
-    const std::string& engineName,
-    const int32_t engineVersion,
-    const int32_t apiVersion) const noexcept
-{
-    VkApplicationInfo appInfo = {};
-    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
-    appInfo.pApplicationName = appName.c_str();
-    appInfo.applicationVersion = appVersion;
-    appInfo.pEngineName = engineName.c_str();
-    appInfo.engineVersion = engineVersion;
-    appInfo.apiVersion = apiVersion;
-    return appInfo;
-}
-
-VkInstanceCreateInfo VulkanCanvas::CreateInstanceCreateInfo(const VkApplicationInfo& appInfo,
-    const std::vector<const char*>& extensionNames,
-    const std::vector<const char*>& layerNames) const noexcept
-{
-    VkInstanceCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
-    createInfo.pApplicationInfo = &appInfo;
-    createInfo.enabledExtensionCount = extensionNames.size();
-    createInfo.ppEnabledExtensionNames = extensionNames.data();
-    createInfo.enabledLayerCount = layerNames.size();
-    createInfo.ppEnabledLayerNames = layerNames.data();
-    return createInfo;
-}
-
-void VulkanCanvas::CreateInstance(const VkInstanceCreateInfo& createInfo)
-{
-    if (!m_vulkanInitialized) {
-        throw std::runtime_error("Programming Error:\nAttempted to create a Vulkan instance before Vulkan was initialized.");
-    }
-    VkResult err = vkCreateInstance(&createInfo, nullptr, &m_instance);
-    if (err != VK_SUCCESS) {
-        throw VulkanException(err, "Unable to create a Vulkan instance:");
-    }
-}
-
-#ifdef _WIN32
-VkWin32SurfaceCreateInfoKHR VulkanCanvas::CreateWin32SurfaceCreateInfo() const noexcept
-{
-    VkWin32SurfaceCreateInfoKHR sci = {};
-    sci.sType = VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR;
-    sci.hwnd = GetHWND();
-    sci.hinstance = GetModuleHandle(NULL);
-    return sci;
-}
-#endif
-
 void VulkanCanvas::CreateWindowSurface()
 {
     if (!m_instance) {
         throw std::runtime_error("Programming Error:\n"
             "Attempted to create a window surface before the Vulkan instance was created.");
     }
-#ifdef _WIN32
-    VkWin32SurfaceCreateInfoKHR sci = CreateWin32SurfaceCreateInfo();
-    VkResult err = vkCreateWin32SurfaceKHR(m_instance, &sci, nullptr, &m_surface);
-    if (err != VK_SUCCESS) {
-        throw VulkanException(err, "Cannot create a Win32 Vulkan surface:");
-    }
-#else
-#error The code in VulkanCanvas::CreateWindowSurface only supports Win32. Changes are \
-required to support other windowing systems.
-#endif
-}
-
-void VulkanCanvas::PickPhysicalDevice()
-{
-    if (!m_instance) {
-        throw std::runtime_error("Programming Error:\n"
-            "Attempted to get a Vulkan physical device before the Vulkan instance was created.");
-    }
-    uint32_t deviceCount = 0;
-    vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
-    if (deviceCount == 0) {
-        throw std::runtime_error("Failed to find a GPU with Vulkan support.");
-    }
-    std::vector<VkPhysicalDevice> devices(deviceCount);
-    vkEnumeratePhysicalDevices(m_instance, &deviceCount, devices.data());
-    for (const auto& device : devices) {
-        if (IsDeviceSuitable(device)) {
-            m_physicalDevice = device;
-            break;
-        }
-    }
-    if (m_physicalDevice == VK_NULL_HANDLE) {
-        throw std::runtime_error("No physical GPU could be found with the required extensions and swap chain support.");
-    }
+    m_surface = PlatformSurface::Create(m_instance, this);
 }
 
 bool VulkanCanvas::IsDeviceSuitable(const VkPhysicalDevice& device) const
@@ -250,152 +147,50 @@ bool VulkanCanvas::IsDeviceSuitable(const VkPhysicalDevice& device) const
         SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(device);
         swapChainAdequate = !swapChainSupport.formats.empty() && !swapChainSupport.presentModes.empty();
     }
-    return indices.IsComplete() & extensionsSupported && swapChainAdequate;
+    return indices.IsComplete() && extensionsSupported && swapChainAdequate;
 }
 
-QueueFamilyIndices VulkanCanvas::FindQueueFamilies(const VkPhysicalDevice& device) const
+SwapChainSupportDetails VulkanCanvas::QuerySwapChainSupport(const VkPhysicalDevice& device) const
 {
-    QueueFamilyIndices indices;
-    uint32_t queueFamilyCount = 0;
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, nullptr);
-    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
-    vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
-
-    int i = 0;
-    for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            indices.graphicsFamily = i;
-        }
-        VkBool32 presentSupport = false;
-        VkResult result = vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+    // the formats and present modes do not change for the life of the surface, so they are only
+    // enumerated once per device; the capabilities include the current extent and are always queried
+    auto iter = m_surfaceSupport.find(device);
+    if (iter == m_surfaceSupport.end()) {
+        SwapChainSupportDetails support = {};
+        uint32_t formatCount = 0;
+        VkResult result = vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
         if (result != VK_SUCCESS) {
-            throw VulkanException(result, "Error while attempting to check if a surface supports presentation:");
-        }
-        if (queueFamily.queueCount > 0 && presentSupport) {
-            indices.presentFamily = i;
+            throw VulkanException(result, "Unable to retrieve the number of formats for a surface on a physical device:");
         }
-        if (indices.IsComplete()) {
-            break;
+        if (formatCount != 0) {
+            support.formats.resize(formatCount);
+            result = vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, support.formats.data());
+            if (result != VK_SUCCESS) {
+                throw VulkanException(result, "Unable to retrieve the formats for a surface on a physical device:");
+            }
         }
-        ++i;
-    }
-    return indices;
-}
 
-bool VulkanCanvas::CheckDeviceExtensionSupport(const VkPhysicalDevice& device) const
-{
-    uint32_t extensionCount;
-    VkResult result = vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Cannot retrieve count of properties for a physical device:");
-    }
-    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
-    result = vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, availableExtensions.data());
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Cannot retrieve properties for a physical device:");
-    }
-    std::set<std::string> requiredExtensions(deviceExtensions.begin(), deviceExtensions.end());
-    for (const auto& extension : availableExtensions) {
-        requiredExtensions.erase(extension.extensionName);
-    }
-
-    return requiredExtensions.empty();
-}
-
-SwapChainSupportDetails VulkanCanvas::QuerySwapChainSupport(const VkPhysicalDevice& device) const
-{
-    SwapChainSupportDetails details;
-
-    VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, m_surface, &details.capabilities);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Unable to retrieve physical device surface capabilities:");
-    }
-    uint32_t formatCount = 0;
-    result = vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, nullptr);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Unable to retrieve the number of formats for a surface on a physical device:");
-    }
-    if (formatCount != 0) {
-        details.formats.resize(formatCount);
-        result = vkGetPhysicalDeviceSurfaceFormatsKHR(device, m_surface, &formatCount, details.formats.data());
+        uint32_t presentModeCount = 0;
+        result = vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, nullptr);
         if (result != VK_SUCCESS) {
-            throw VulkanException(result, "Unable to retrieve the formats for a surface on a physical device:");
+            throw VulkanException(result, "Unable to retrieve the count of present modes for a surface on a physical device:");
         }
-    }
-
-    uint32_t presentModeCount = 0;
-    result = vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, nullptr);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Unable to retrieve the count of present modes for a surface on a physical device:");
-    }
-    if (presentModeCount != 0) {
-        details.presentModes.resize(presentModeCount);
-        result =vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, details.presentModes.data());
-        if (result != VK_SUCCESS) {
-            throw VulkanException(result, "Unable to retrieve the present modes for a surface on a physical device:");
+        if (presentModeCount != 0) {
+            support.presentModes.resize(presentModeCount);
+            result = vkGetPhysicalDeviceSurfacePresentModesKHR(device, m_surface, &presentModeCount, support.presentModes.data());
+            if (result != VK_SUCCESS) {
+                throw VulkanException(result, "Unable to retrieve the present modes for a surface on a physical device:");
+            }
         }
+        iter = m_surfaceSupport.insert({ device, support }).first;
     }
-    return details;
-}
-
-VkDeviceQueueCreateInfo VulkanCanvas::CreateDeviceQueueCreateInfo(int queueFamily) const noexcept
-{
-    float queuePriority = 1.0f;
-    VkDeviceQueueCreateInfo queueCreateInfo = {};
-    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfo.queueFamilyIndex = queueFamily;
-    queueCreateInfo.queueCount = 1;
-    queueCreateInfo.pQueuePriorities = &queuePriority;
-    return queueCreateInfo;
-}
-
-std::vector<VkDeviceQueueCreateInfo> VulkanCanvas::CreateQueueCreateInfos(
-    const std::set<int>& uniqueQueueFamilies) const noexcept
-{
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-
-    for (int queueFamily : uniqueQueueFamilies) {
-        VkDeviceQueueCreateInfo queueCreateInfo = CreateDeviceQueueCreateInfo(queueFamily);
-        queueCreateInfos.push_back(queueCreateInfo);
-    }
-    return queueCreateInfos;
-}
-
-VkDeviceCreateInfo VulkanCanvas::CreateDeviceCreateInfo(
-    const std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos,
-    const VkPhysicalDeviceFeatures& deviceFeatures) const noexcept
-{
-    VkDeviceCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.pQueueCreateInfos = queueCreateInfos.data();
-    createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
-    createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = deviceExtensions.size();
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
-    if (enableValidationLayers) {
-        createInfo.enabledLayerCount = validationLayers.size();
-        createInfo.ppEnabledLayerNames = validationLayers.data();
-    }
-    else {
-        createInfo.enabledLayerCount = 0;
-    }
-    return createInfo;
-}
-
-void VulkanCanvas::CreateLogicalDevice()
-{
-    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
-    std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily };
-    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos = CreateQueueCreateInfos(uniqueQueueFamilies);
-    VkPhysicalDeviceFeatures deviceFeatures = {};
-    VkDeviceCreateInfo createInfo = CreateDeviceCreateInfo(queueCreateInfos, deviceFeatures);
 
-    VkResult result = vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_logicalDevice);
+    SwapChainSupportDetails details = iter->second;
+    VkResult result = vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, m_surface, &details.capabilities);
     if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Unable to create a logical device");
+        throw VulkanException(result, "Unable to retrieve physical device surface capabilities:");
     }
-    vkGetDeviceQueue(m_logicalDevice, indices.graphicsFamily, 0, &m_graphicsQueue);
-    vkGetDeviceQueue(m_logicalDevice, indices.graphicsFamily, 0, &m_presentQueue);
+    return details;
 }
 
 VkSwapchainCreateInfoKHR VulkanCanvas::CreateSwapchainCreateInfo(
@@ -432,17 +227,20 @@ VkSwapchainCreateInfoKHR VulkanCanvas::CreateSwapchainCreateInfo(
     return createInfo;
 }
 
+void VulkanCanvas::ChooseSurfaceFormat()
+{
+    SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(m_physicalDevice);
+    m_surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
+    m_imageFormat = m_surfaceFormat.format;
+}
+
 void VulkanCanvas::CreateSwapChain(const wxSize& size)
 {
     SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(m_physicalDevice);
-    VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.formats);
     VkExtent2D extent = ChooseSwapExtent(swapChainSupport.capabilities, size);
-    uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-    if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-        imageCount = swapChainSupport.capabilities.maxImageCount;
-    }
+    uint32_t imageCount = ChooseSwapImageCount(swapChainSupport.capabilities);
     VkSwapchainCreateInfoKHR createInfo = CreateSwapchainCreateInfo(swapChainSupport,
-        surfaceFormat, imageCount, extent);
+        m_surfaceFormat, imageCount, extent);
     VkSwapchainKHR oldSwapchain = m_swapchain;
     createInfo.oldSwapchain = oldSwapchain;
     VkSwapchainKHR newSwapchain;
@@ -456,13 +254,13 @@ void VulkanCanvas::CreateSwapChain(const wxSize& size)
     if (result != VK_SUCCESS) {
         throw VulkanException(result, "Error attempting to retrieve the count of swapchain images:");
     }
-    m_swapchainImages.resize(imageCount);
-    result = vkGetSwapchainImagesKHR(m_logicalDevice, m_swapchain, &imageCount, m_swapchainImages.data());
+    m_images.resize(imageCount);
+    result = vkGetSwapchainImagesKHR(m_logicalDevice, m_swapchain, &imageCount, m_images.data());
     if (result != VK_SUCCESS) {
         throw VulkanException(result, "Error attempting to retrieve the swapchain images:");
     }
-    m_swapchainImageFormat = surfaceFormat.format;
-    m_swapchainExtent = extent;
+    m_extent = extent;
+    m_presentMode = createInfo.presentMode;
 }
 
 VkSurfaceFormatKHR VulkanCanvas::ChooseSwapSurfaceFormat(
@@ -483,14 +281,27 @@ VkSurfaceFormatKHR VulkanCanvas::ChooseSwapSurfaceFormat(
 VkPresentModeKHR VulkanCanvas::ChooseSwapPresentMode(
     const std::vector<VkPresentModeKHR>& availablePresentModes) const noexcept
 {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
+    for (const auto& preferredMode : m_presentationPolicy.presentModes) {
+        if (std::find(availablePresentModes.begin(), availablePresentModes.end(), preferredMode) !=
+            availablePresentModes.end()) {
+            return preferredMode;
         }
     }
     return VK_PRESENT_MODE_FIFO_KHR;
 }
 
+uint32_t VulkanCanvas::ChooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities) const noexcept
+{
+    uint32_t imageCount = m_presentationPolicy.imageCount == 0 ?
+        capabilities.minImageCount + 1 : m_presentationPolicy.imageCount;
+    imageCount = std::max(imageCount, capabilities.minImageCount);
+    // a maxImageCount of 0 means there is no upper limit
+    if (capabilities.maxImageCount > 0 && imageCount > capabilities.maxImageCount) {
+        imageCount = capabilities.maxImageCount;
+    }
+    return imageCount;
+}
+
 VkExtent2D VulkanCanvas::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities,
     const wxSize& size) const noexcept
 {
@@ -508,572 +319,211 @@ VkExtent2D VulkanCanvas::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabi
     }
 }
 
-VkImageViewCreateInfo VulkanCanvas::CreateImageViewCreateInfo(uint32_t swapchainImage) const noexcept
-{
-    VkImageViewCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    createInfo.image = m_swapchainImages[swapchainImage];
-    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    createInfo.format = m_swapchainImageFormat;
-    createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    createInfo.subresourceRange.baseMipLevel = 0;
-    createInfo.subresourceRange.levelCount = 1;
-    createInfo.subresourceRange.baseArrayLayer = 0;
-    createInfo.subresourceRange.layerCount = 1;
-    return createInfo;
-}
-
-void VulkanCanvas::CreateImageViews()
-{
-    m_swapchainImageViews.resize(m_swapchainImages.size());
-    for (uint32_t i = 0; i < m_swapchainImages.size(); i++) {
-        VkImageViewCreateInfo createInfo = CreateImageViewCreateInfo(i);
-
-        VkResult result = vkCreateImageView(m_logicalDevice, &createInfo, nullptr, &m_swapchainImageViews[i]);
-        if (result != VK_SUCCESS) {
-            throw VulkanException(result, "Unable to create an image view for a swap chain image");
-        }
-    }
-}
-
-VkAttachmentDescription VulkanCanvas::CreateAttachmentDescription() const noexcept
-{
-    VkAttachmentDescription colorAttachment = {};
-    colorAttachment.format = m_swapchainImageFormat;
-    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-    return colorAttachment;
-}
-
-VkAttachmentReference VulkanCanvas::CreateAttachmentReference() const noexcept
-{
-    VkAttachmentReference colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-    return colorAttachmentRef;
-}
-
-VkSubpassDescription VulkanCanvas::CreateSubpassDescription(
-    const VkAttachmentReference& attachmentRef) const noexcept
-{
-    VkSubpassDescription subPass = {};
-    subPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subPass.colorAttachmentCount = 1;
-    subPass.pColorAttachments = &attachmentRef;
-    return subPass;
-}
-
-VkSubpassDependency VulkanCanvas::CreateSubpassDependency() const noexcept
-{
-    VkSubpassDependency dependency = {};
-    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-    dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-    dependency.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-    return dependency;
-}
-
-VkRenderPassCreateInfo VulkanCanvas::CreateRenderPassCreateInfo(
-    const VkAttachmentDescription& colorAttachment,
-    const VkSubpassDescription& subPass,
-    const VkSubpassDependency& dependency) const noexcept
-{
-    VkRenderPassCreateInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassInfo.attachmentCount = 1;
-    renderPassInfo.pAttachments = &colorAttachment;
-    renderPassInfo.subpassCount = 1;
-    renderPassInfo.pSubpasses = &subPass;
-    renderPassInfo.dependencyCount = 1;
-    renderPassInfo.pDependencies = &dependency;
-    return renderPassInfo;
-}
-
-void VulkanCanvas::CreateRenderPass() 
-{
-    VkAttachmentDescription colorAttachment = CreateAttachmentDescription();
-    VkAttachmentReference colorAttachmentRef = CreateAttachmentReference();
-    VkSubpassDescription subPass = CreateSubpassDescription(colorAttachmentRef);
-    VkSubpassDependency dependency = CreateSubpassDependency();
-    VkRenderPassCreateInfo renderPassInfo = CreateRenderPassCreateInfo(colorAttachment,
-        subPass, dependency);
-
-    VkResult result = vkCreateRenderPass(m_logicalDevice, &renderPassInfo, nullptr, &m_renderPass);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to create a render pass:");
-    }
-}
-
-VkPipelineShaderStageCreateInfo VulkanCanvas::CreatePipelineShaderStageCreateInfo(
-    VkShaderStageFlagBits stage, VkShaderModule& module, const char* entryName) const noexcept
-{
-    VkPipelineShaderStageCreateInfo shaderStageInfo = {};
-    shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    shaderStageInfo.stage = stage;
-    shaderStageInfo.module = module;
-    shaderStageInfo.pName = entryName;
-    return shaderStageInfo;
-}
-
-VkPipelineVertexInputStateCreateInfo VulkanCanvas::CreatePipelineVertexInputStateCreateInfo() const noexcept
-{
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    return vertexInputInfo;
-}
-
-VkPipelineInputAssemblyStateCreateInfo VulkanCanvas::CreatePipelineInputAssemblyStateCreateInfo(
-    const VkPrimitiveTopology& topology, uint32_t restartEnable) const noexcept
-{
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly = {};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = topology;
-    inputAssembly.primitiveRestartEnable = restartEnable;
-    return inputAssembly;
-}
-
-VkViewport VulkanCanvas::CreateViewport() const noexcept
-{
-    VkViewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = (float)m_swapchainExtent.width;
-    viewport.height = (float)m_swapchainExtent.height;
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    return viewport;
-}
-
-VkRect2D VulkanCanvas::CreateScissor() const noexcept
-{
-    VkRect2D scissor = {};
-    scissor.offset = { 0, 0 };
-    scissor.extent = m_swapchainExtent;
-    return scissor;
-}
-
-VkPipelineViewportStateCreateInfo VulkanCanvas::CreatePipelineViewportStateCreateInfo(
-    const VkViewport& viewport, const VkRect2D& scissor) const noexcept
-{
-    VkPipelineViewportStateCreateInfo viewportState = {};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
-    return viewportState;
-}
-
-VkPipelineRasterizationStateCreateInfo VulkanCanvas::CreatePipelineRasterizationStateCreateInfo() const noexcept
-{
-    VkPipelineRasterizationStateCreateInfo rasterizer = {};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    return rasterizer;
-}
-
-VkPipelineMultisampleStateCreateInfo VulkanCanvas::CreatePipelineMultisampleStateCreateInfo() const noexcept
-{
-    VkPipelineMultisampleStateCreateInfo multisampling = {};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    return multisampling;
-}
-
-VkPipelineColorBlendAttachmentState VulkanCanvas::CreatePipelineColorBlendAttachmentState() const noexcept
-{
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = {};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    return colorBlendAttachment;
-}
-
-VkPipelineColorBlendStateCreateInfo VulkanCanvas::CreatePipelineColorBlendStateCreateInfo(
-    const VkPipelineColorBlendAttachmentState& colorBlendAttachment) const noexcept
-{
-    VkPipelineColorBlendStateCreateInfo colorBlending = {};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-    return colorBlending;
-}
-
-VkPipelineLayoutCreateInfo VulkanCanvas::CreatePipelineLayoutCreateInfo() const noexcept
-{
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 0;
-    pipelineLayoutInfo.pushConstantRangeCount = 0;
-    return pipelineLayoutInfo;
-}
-
-VkGraphicsPipelineCreateInfo VulkanCanvas::CreateGraphicsPipelineCreateInfo(
-    const VkPipelineShaderStageCreateInfo shaderStages[],
-    const VkPipelineVertexInputStateCreateInfo& vertexInputInfo,
-    const VkPipelineInputAssemblyStateCreateInfo& inputAssembly,
-    const VkPipelineViewportStateCreateInfo& viewportState,
-    const VkPipelineRasterizationStateCreateInfo& rasterizer,
-    const VkPipelineMultisampleStateCreateInfo& multisampling,
-    const VkPipelineColorBlendStateCreateInfo& colorBlending) const noexcept
-{
-    VkGraphicsPipelineCreateInfo pipelineInfo = {};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = m_renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-    return pipelineInfo;
-}
-
-void VulkanCanvas::CreateGraphicsPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile)
+void VulkanCanvas::RecreateSwapchain()
 {
-    auto vertShaderCode = ReadFile(vertexShaderFile);
-    auto fragShaderCode = ReadFile(fragmentShaderFile);
-
-    VkShaderModule vertShaderModule;
-    VkShaderModule fragShaderModule;
-   
-    CreateShaderModule(vertShaderCode, vertShaderModule);
-    CreateShaderModule(fragShaderCode, fragShaderModule);
-
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo = CreatePipelineShaderStageCreateInfo(
-        VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main");
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo = CreatePipelineShaderStageCreateInfo(
-        VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule, "main");
-    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
-    
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo = CreatePipelineVertexInputStateCreateInfo();
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly = CreatePipelineInputAssemblyStateCreateInfo(
-        VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
-    VkViewport viewport = CreateViewport();
-    VkRect2D scissor = CreateScissor();
-    VkPipelineViewportStateCreateInfo viewportState = CreatePipelineViewportStateCreateInfo(
-        viewport, scissor);
-    VkPipelineRasterizationStateCreateInfo rasterizer = CreatePipelineRasterizationStateCreateInfo();
-    VkPipelineMultisampleStateCreateInfo multisampling = CreatePipelineMultisampleStateCreateInfo();
-    VkPipelineColorBlendAttachmentState colorBlendAttachment = CreatePipelineColorBlendAttachmentState();
-    VkPipelineColorBlendStateCreateInfo colorBlending = CreatePipelineColorBlendStateCreateInfo(
-        colorBlendAttachment);
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = CreatePipelineLayoutCreateInfo();
-
-    VkResult result = vkCreatePipelineLayout(m_logicalDevice, &pipelineLayoutInfo, nullptr, &m_pipelineLayout);
-    if(result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to create pipeline layout:");
+    // only the frames still in flight can be using the objects that are replaced below, so they
+    // are retired rather than destroyed and rendering carries on with the new swapchain
+    VkFormat oldFormat = m_imageFormat;
+    VkSwapchainKHR oldSwapchain = m_swapchain;
+    wxSize size = GetSize();
+    ChooseSurfaceFormat();
+    CreateSwapChain(size);
+    RetireFrameBuffers();
+    RetireImageViews();
+    if (oldSwapchain != VK_NULL_HANDLE) {
+        VkDevice device = m_logicalDevice;
+        m_deletionQueue.Retire(GetFramesInFlight(), [device, oldSwapchain] {
+            vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+        });
     }
-
-    VkGraphicsPipelineCreateInfo pipelineInfo = CreateGraphicsPipelineCreateInfo(shaderStages,
-        vertexInputInfo, inputAssembly, viewportState, rasterizer, multisampling, colorBlending);
-
-
-    result = vkCreateGraphicsPipelines(m_logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline);
-    // vkDestroyShaderModule calls below must be placed before possible throw of exception
-    vkDestroyShaderModule(m_logicalDevice, fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_logicalDevice, vertShaderModule, nullptr);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to create graphics pipeline:");
+    CreateImageViews();
+    // viewport and scissor are dynamic state, so the render pass and pipeline only
+    // need rebuilding when the surface format changes
+    if (m_imageFormat != oldFormat) {
+        DestroyGraphicsPipeline();
+        RetireRenderPass();
+        CreateRenderPass();
+        CreateGraphicsPipeline("vert.spv", "frag.spv");
     }
+    CreateFrameBuffers();
+    m_imagesInFlight.assign(m_images.size(), SubmitPoint());
 }
 
-std::vector<char> VulkanCanvas::ReadFile(const std::string& filename)
+VkSubmitInfo VulkanCanvas::CreateSubmitInfo(const CanvasFrame& canvasFrame) noexcept
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-
-    if (!file.is_open()) {
-        std::stringstream ss;
-        ss << "Failed to open file: " << filename;
-        throw std::runtime_error(ss.str().c_str());
-    }
-
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(canvasFrame.waits.semaphores.size());
+    submitInfo.pWaitSemaphores = canvasFrame.waits.semaphores.data();
+    submitInfo.pWaitDstStageMask = canvasFrame.waits.stages.data();
 
-    file.close();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &canvasFrame.commandBuffer;
 
-    return buffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &canvasFrame.renderFinishedSemaphore;
+    return submitInfo;
 }
 
-VkShaderModuleCreateInfo VulkanCanvas::CreateShaderModuleCreateInfo(
-    const std::vector<char>& code) const noexcept
+VkPresentInfoKHR VulkanCanvas::CreatePresentInfoKHR(const CanvasFrame& canvasFrame) const noexcept
 {
-    VkShaderModuleCreateInfo createInfo = {};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = (uint32_t*)code.data();
-    return createInfo;
-}
+    VkPresentInfoKHR presentInfo = {};
+    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 
-void VulkanCanvas::CreateShaderModule(const std::vector<char>& code, VkShaderModule& shaderModule) const
-{
-    VkShaderModuleCreateInfo createInfo = CreateShaderModuleCreateInfo(code);
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &canvasFrame.renderFinishedSemaphore;
 
-    VkResult result = vkCreateShaderModule(m_logicalDevice, &createInfo, nullptr, &shaderModule);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to create shader module:");
-    }
-}
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &canvasFrame.swapchain;
 
-VkFramebufferCreateInfo VulkanCanvas::CreateFramebufferCreateInfo(
-    const VkImageView& attachments) const noexcept
-{
-    VkFramebufferCreateInfo framebufferInfo = {};
-    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-    framebufferInfo.renderPass = m_renderPass;
-    framebufferInfo.attachmentCount = 1;
-    framebufferInfo.pAttachments = &attachments;
-    framebufferInfo.width = m_swapchainExtent.width;
-    framebufferInfo.height = m_swapchainExtent.height;
-    framebufferInfo.layers = 1;
-    return framebufferInfo;
+    presentInfo.pImageIndices = &canvasFrame.imageIndex;
+    return presentInfo;
 }
 
-void VulkanCanvas::CreateFrameBuffers()
+void VulkanCanvas::OnPaint(wxPaintEvent& event)
 {
-    VkFramebuffer framebuffer;
-    m_swapchainFramebuffers.resize(m_swapchainImageViews.size(), framebuffer);
-
-    for (size_t i = 0; i < m_swapchainImageViews.size(); i++) {
-        VkImageView attachments[] = {
-            m_swapchainImageViews[i]
-        };
-
-        VkFramebufferCreateInfo framebufferInfo = CreateFramebufferCreateInfo(*attachments);
-
-        VkResult result = vkCreateFramebuffer(m_logicalDevice, &framebufferInfo, nullptr, &m_swapchainFramebuffers[i]);
-        if (result != VK_SUCCESS) {
-            throw VulkanException(result, "Failed to create framebuffer:");
-        }
+    if (!m_renderOnPaint) {
+        // a RenderLoop is producing the frames; just validate the window
+        wxPaintDC dc(this);
+        return;
     }
+    RenderFrame();
 }
 
-VkCommandPoolCreateInfo VulkanCanvas::CreateCommandPoolCreateInfo(
-    QueueFamilyIndices& queueFamilyIndices) const noexcept
+bool VulkanCanvas::AcquireFrame(CanvasFrame& canvasFrame)
 {
-    VkCommandPoolCreateInfo poolInfo = {};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
-    return poolInfo;
-}
+    FrameData& frame = m_frames[m_currentFrame];
+    // bound how far the CPU can get ahead of the GPU
+    WaitForSubmit(frame.submitted);
+    m_frameProfiler.CollectGpuResults(static_cast<uint32_t>(m_currentFrame));
 
-void VulkanCanvas::CreateCommandPool() {
-    QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(m_physicalDevice);
-    VkCommandPoolCreateInfo poolInfo = CreateCommandPoolCreateInfo(queueFamilyIndices);
-    VkResult result = vkCreateCommandPool(m_logicalDevice, &poolInfo, nullptr, &m_commandPool);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to create command pool:");
+    uint32_t imageIndex;
+    VkResult result;
+    {
+        StageTimer timer(m_frameProfiler, FrameStage::Acquire);
+        result = vkAcquireNextImageKHR(m_logicalDevice, m_swapchain, std::numeric_limits<uint64_t>::max(),
+            frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
     }
-}
-
-VkCommandBufferAllocateInfo VulkanCanvas::CreateCommandBufferAllocateInfo() const noexcept
-{
-    VkCommandBufferAllocateInfo allocInfo = {};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.commandPool = m_commandPool;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandBufferCount = (uint32_t)m_commandBuffers.size();
-    return allocInfo;
-}
 
-VkCommandBufferBeginInfo VulkanCanvas::CreateCommandBufferBeginInfo() const noexcept
-{
-    VkCommandBufferBeginInfo beginInfo = {};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-    return beginInfo;
-}
-
-VkRenderPassBeginInfo VulkanCanvas::CreateRenderPassBeginInfo(size_t swapchainBufferNumber,
-    const VkClearValue& clearValue) const noexcept
-{
-    VkRenderPassBeginInfo renderPassInfo = {};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = m_renderPass;
-    renderPassInfo.framebuffer = m_swapchainFramebuffers[swapchainBufferNumber];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = m_swapchainExtent;
-
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearValue;
-    return renderPassInfo;
-}
-
-void VulkanCanvas::CreateCommandBuffers()
-{
-    if (m_commandBuffers.size() > 0) {
-        vkFreeCommandBuffers(m_logicalDevice, m_commandPool, m_commandBuffers.size(), m_commandBuffers.data());
+    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+        RecreateSwapchain();
+        return false;
     }
-    m_commandBuffers.resize(m_swapchainFramebuffers.size());
-
-    VkCommandBufferAllocateInfo allocInfo = CreateCommandBufferAllocateInfo();
-    VkResult result = vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, m_commandBuffers.data());
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to allocate command buffers:");
+    else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+        throw VulkanException(result, "Failed to acquire swap chain image");
     }
+    // an earlier frame slot may still be rendering to this swapchain image
+    WaitForSubmit(m_imagesInFlight[imageIndex]);
 
-    VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-    for (size_t i = 0; i < m_commandBuffers.size(); i++) {
-
-        VkCommandBufferBeginInfo beginInfo = CreateCommandBufferBeginInfo();
-        vkBeginCommandBuffer(m_commandBuffers[i], &beginInfo);
-
-        VkRenderPassBeginInfo renderPassInfo = CreateRenderPassBeginInfo(i, clearColor);
-        vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
-        vkCmdDraw(m_commandBuffers[i], 3, 1, 0, 0);
-        vkCmdEndRenderPass(m_commandBuffers[i]);
-
-        result = vkEndCommandBuffer(m_commandBuffers[i]);
-        if (result != VK_SUCCESS) {
-            throw VulkanException(result, "Failed to record command buffer:");
-        }
+    canvasFrame.waits.Add(frame.imageAvailableSemaphore, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT);
+    {
+        StageTimer timer(m_frameProfiler, FrameStage::Record);
+        RecordCommandBuffer(frame, imageIndex, canvasFrame.waits);
     }
+    canvasFrame.frameSlot = m_currentFrame;
+    canvasFrame.commandBuffer = frame.commandBuffer;
+    canvasFrame.renderFinishedSemaphore = frame.renderFinishedSemaphore;
+    canvasFrame.swapchain = m_swapchain;
+    canvasFrame.imageIndex = imageIndex;
+    m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+    return true;
 }
 
-VkSemaphoreCreateInfo VulkanCanvas::CreateSemaphoreCreateInfo() const noexcept
+void VulkanCanvas::SetSubmitted(const CanvasFrame& canvasFrame, const SubmitPoint& point) noexcept
 {
-    VkSemaphoreCreateInfo semaphoreInfo = {};
-    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-    return semaphoreInfo;
+    m_frames[canvasFrame.frameSlot].submitted = point;
+    m_imagesInFlight[canvasFrame.imageIndex] = point;
 }
 
-void VulkanCanvas::CreateSemaphores()
+void VulkanCanvas::FinishPresent(VkResult result)
 {
-    VkSemaphoreCreateInfo semaphoreInfo = CreateSemaphoreCreateInfo();
-
-    VkResult result = vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_imageAvailableSemaphore);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to create image available semaphore:");
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+        RecreateSwapchain();
     }
-    result = vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &m_renderFinishedSemaphore);
-    if (result != VK_SUCCESS) {
-        throw VulkanException(result, "Failed to create render finished semaphore:");
+    else if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to present swap chain image:");
     }
 }
 
-void VulkanCanvas::RecreateSwapchain()
-{
-    vkDeviceWaitIdle(m_logicalDevice);
-
-    wxSize size = GetSize();
-    CreateSwapChain(size);
-    CreateImageViews();
-    CreateRenderPass();
-    CreateGraphicsPipeline("vert.spv", "frag.spv");
-    CreateFrameBuffers();
-    CreateCommandBuffers();
-}
-
-VkSubmitInfo VulkanCanvas::CreateSubmitInfo(uint32_t imageIndex,
-	VkPipelineStageFlags* waitStageFlags) const noexcept
-{
-    VkSubmitInfo submitInfo = {};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = &m_imageAvailableSemaphore;
-    submitInfo.pWaitDstStageMask = waitStageFlags;
-
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &m_commandBuffers[imageIndex];
-
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = &m_renderFinishedSemaphore;
-    return submitInfo;
-}
-
-VkPresentInfoKHR VulkanCanvas::CreatePresentInfoKHR(uint32_t& imageIndex) const noexcept
-{
-    VkPresentInfoKHR presentInfo = {};
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = &m_renderFinishedSemaphore;
-
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = &m_swapchain;
-
-    presentInfo.pImageIndices = &imageIndex;
-    return presentInfo;
-}
-
-void VulkanCanvas::OnPaint(wxPaintEvent& event)
+bool VulkanCanvas::RenderFrame()
 {
     try {
-        uint32_t imageIndex;
-        VkResult result = vkAcquireNextImageKHR(m_logicalDevice, m_swapchain,
-            std::numeric_limits<uint64_t>::max(), m_imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
-
-        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            RecreateSwapchain();
-            return;
+        if (m_coordinator != nullptr) {
+            m_coordinator->RenderFrame();
+            return true;
         }
-        else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-            throw VulkanException(result, "Failed to acquire swap chain image");
+        CanvasFrame canvasFrame;
+        if (!AcquireFrame(canvasFrame)) {
+            return true;
+        }
+
+        VkSubmitInfo submitInfo = CreateSubmitInfo(canvasFrame);
+        SubmitPoint point = m_context->BeginSubmit(m_graphicsQueue, m_frames[canvasFrame.frameSlot].inFlightFence);
+        TimelineSubmit timelineSubmit;
+        timelineSubmit.Apply(submitInfo, canvasFrame.waits, point);
+        VkResult result;
+        {
+            StageTimer timer(m_frameProfiler, FrameStage::Submit);
+            result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, point.fence);
         }
-		VkPipelineStageFlags waitFlags[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
-        VkSubmitInfo submitInfo = CreateSubmitInfo(imageIndex, waitFlags);
-        result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
         if (result != VK_SUCCESS) {
+            m_context->CancelSubmit(m_graphicsQueue, point);
             throw VulkanException(result, "Failed to submit draw command buffer:");
         }
+        SetSubmitted(canvasFrame, point);
 
-        VkPresentInfoKHR presentInfo = CreatePresentInfoKHR(imageIndex);
-        result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
-        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-            RecreateSwapchain();
-        }
-        else if (result != VK_SUCCESS) {
-            throw VulkanException(result, "Failed to present swap chain image:");
+        VkPresentInfoKHR presentInfo = CreatePresentInfoKHR(canvasFrame);
+        {
+            StageTimer timer(m_frameProfiler, FrameStage::Present);
+            result = vkQueuePresentKHR(m_presentQueue, &presentInfo);
         }
+        FinishPresent(result);
     }
     catch (const VulkanException& ve) {
         std::string status = ve.GetStatus();
         std::stringstream ss;
         ss << ve.what() << "\n" << status;
         CallAfter(&VulkanCanvas::OnPaintException, ss.str());
+        return false;
     }
     catch (const std::exception& err) {
         std::stringstream ss;
         ss << "Error encountered trying to create the Vulkan canvas:\n";
         ss << err.what();
         CallAfter(&VulkanCanvas::OnPaintException, ss.str());
+        return false;
     }
+    return true;
+}
+
+void VulkanCanvas::SetRenderOnPaint(bool renderOnPaint) noexcept
+{
+    m_renderOnPaint = renderOnPaint;
+}
+
+void VulkanCanvas::SetFrameCoordinator(FrameCoordinator* coordinator) noexcept
+{
+    m_coordinator = coordinator;
+    if (coordinator == nullptr) {
+        // the coordinator has waited for its frames, and its fences are about to be destroyed; every
+        // point that retired objects still hold on those fences has signaled, so collecting drops them
+        m_deletionQueue.Collect();
+        for (auto& frame : m_frames) {
+            frame.submitted = SubmitPoint();
+        }
+        m_imagesInFlight.assign(m_imagesInFlight.size(), SubmitPoint());
+    }
+}
+
+void VulkanCanvas::SetPresentationPolicy(const PresentationPolicy& policy)
+{
+    if (policy.presentModes == m_presentationPolicy.presentModes &&
+        policy.imageCount == m_presentationPolicy.imageCount) {
+        return;
+    }
+    m_presentationPolicy = policy;
+    RecreateSwapchain();
 }
 
 void VulkanCanvas::OnResize(wxSizeEvent& event)
@@ -1,19 +1,12 @@
 #pragma once
 #include "wx/wx.h"
-#define VK_USE_PLATFORM_WIN32_KHR
 #include <vulkan/vulkan.h>
+#include <map>
 #include <string>
 #include <vector>
-#include <set>
+#include "VulkanRenderer.h"
 
-struct QueueFamilyIndices {
-    int graphicsFamily = -1;
-    int presentFamily = -1;
-
-    bool IsComplete() {
-        return graphicsFamily >= 0 && presentFamily >= 0;
-    }
-};
+class FrameCoordinator;
 
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
@@ -21,9 +14,37 @@ struct SwapChainSupportDetails {
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+// How the swapchain presents: the present modes to try, in order of preference, and the
+// number of swapchain images to request. FIFO is always supported and is used when none
+// of the preferred modes are available.
+struct PresentationPolicy {
+    std::vector<VkPresentModeKHR> presentModes;
+    // 0 requests one more than the surface minimum; other values are clamped to the surface limits
+    uint32_t imageCount = 0;
+
+    // MAILBOX if available, otherwise FIFO; what VulkanCanvas has always used
+    static PresentationPolicy Default();
+    // the newest frame reaches the display as soon as possible, with as few queued images as possible
+    static PresentationPolicy LowLatency();
+    // never block on the display; more images so the GPU always has one to render into
+    static PresentationPolicy MaxThroughput();
+    // one frame per vertical blank
+    static PresentationPolicy VSync();
+};
+
+// What a canvas has recorded for one frame and still has to be submitted and presented
+struct CanvasFrame {
+    // the canvas's frame slot that was recorded
+    size_t frameSlot = 0;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    SubmitWaits waits;
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    uint32_t imageIndex = 0;
+};
 
 class VulkanCanvas :
-    public wxWindow
+    public wxWindow, public VulkanRenderer
 {
 public:
     VulkanCanvas(wxWindow *pParent,
@@ -31,122 +52,67 @@ public:
         const wxPoint& pos = wxDefaultPosition,
         const wxSize& size = wxDefaultSize,
         long style = 0,
-        const wxString& name = "VulkanCanvasName");
+        const wxString& name = "VulkanCanvasName",
+        std::shared_ptr<VulkanContext> context = nullptr);
 
     virtual ~VulkanCanvas() noexcept;
 
+    // Acquires, records, submits and presents one frame. Returns false if rendering failed;
+    // the error has then already been reported. If the canvas belongs to a FrameCoordinator,
+    // all of the coordinator's canvases are rendered.
+    bool RenderFrame();
+    // When false, paint events no longer render; frames come from a RenderLoop instead.
+    void SetRenderOnPaint(bool renderOnPaint) noexcept;
+    // Recreates the swapchain (but nothing that does not depend on it) if the policy changes.
+    void SetPresentationPolicy(const PresentationPolicy& policy);
+    const PresentationPolicy& GetPresentationPolicy() const noexcept { return m_presentationPolicy; }
+    VkPresentModeKHR GetPresentMode() const noexcept { return m_presentMode; }
+    uint32_t GetSwapchainImageCount() const noexcept { return static_cast<uint32_t>(m_images.size()); }
+
+    // Used by FrameCoordinator
+    void SetFrameCoordinator(FrameCoordinator* coordinator) noexcept;
+    VkQueue GetGraphicsQueue() const noexcept { return m_graphicsQueue; }
+    VkQueue GetPresentQueue() const noexcept { return m_presentQueue; }
+    // Waits for the next frame slot, acquires a swapchain image and records the frame, which the
+    // caller must submit and then pass to SetSubmitted. Returns false, and leaves nothing to
+    // submit, if the swapchain was out of date and has been recreated instead.
+    bool AcquireFrame(CanvasFrame& canvasFrame);
+    // Records where the CPU can wait for canvasFrame's submission to complete
+    void SetSubmitted(const CanvasFrame& canvasFrame, const SubmitPoint& point) noexcept;
+    // Handles this swapchain's result from a present
+    void FinishPresent(VkResult result);
+    static VkSubmitInfo CreateSubmitInfo(const CanvasFrame& canvasFrame) noexcept;
+
 private:
-    void InitializeVulkan(std::vector<const char*> extensions);
-    void CreateInstance(const VkInstanceCreateInfo& createInfo);
     void CreateWindowSurface();
-    void PickPhysicalDevice();
-    void CreateLogicalDevice();
+    void ChooseSurfaceFormat();
     void CreateSwapChain(const wxSize& size);
-    void CreateImageViews();
-    void CreateRenderPass();
-    void CreateGraphicsPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
-    void CreateFrameBuffers();
-    void CreateCommandPool();
-    void CreateCommandBuffers();
-    void CreateSemaphores();
     void RecreateSwapchain();
-    VkWin32SurfaceCreateInfoKHR VulkanCanvas::CreateWin32SurfaceCreateInfo() const noexcept;
-    VkDeviceQueueCreateInfo CreateDeviceQueueCreateInfo(int queueFamily) const noexcept;
-    VkApplicationInfo CreateApplicationInfo(const std::string& appName,
-        const int32_t appVersion = VK_MAKE_VERSION(1, 0, 0),
-        const std::string& engineName = "No Engine",
-        const int32_t engineVersion = VK_MAKE_VERSION(1, 0, 0),
-        const int32_t apiVersion = VK_API_VERSION_1_0) const noexcept;
-    VkInstanceCreateInfo CreateInstanceCreateInfo(const VkApplicationInfo& appInfo,
-        const std::vector<const char*>& extensionNames,
-        const std::vector<const char*>& layerNames) const noexcept;
-    std::vector<VkDeviceQueueCreateInfo> VulkanCanvas::CreateQueueCreateInfos(
-        const std::set<int>& uniqueQueueFamilies) const noexcept;
-    VkDeviceCreateInfo CreateDeviceCreateInfo(
-        const std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos,
-        const VkPhysicalDeviceFeatures& deviceFeatures) const noexcept;
     VkSwapchainCreateInfoKHR CreateSwapchainCreateInfo(
         const SwapChainSupportDetails& swapChainSupport,
         const VkSurfaceFormatKHR& surfaceFormat,
         uint32_t imageCount,
         const VkExtent2D& extent);
-    VkImageViewCreateInfo CreateImageViewCreateInfo(uint32_t swapchainImage) const noexcept;
-    VkAttachmentDescription CreateAttachmentDescription() const noexcept;
-    VkAttachmentReference CreateAttachmentReference() const noexcept;
-    VkSubpassDescription CreateSubpassDescription(const VkAttachmentReference& attachmentRef) const noexcept;
-    VkSubpassDependency CreateSubpassDependency() const noexcept;
-    VkRenderPassCreateInfo CreateRenderPassCreateInfo(
-        const VkAttachmentDescription& colorAttachment,
-        const VkSubpassDescription& subPass,
-        const VkSubpassDependency& dependency) const noexcept;
-    VkPipelineShaderStageCreateInfo CreatePipelineShaderStageCreateInfo(
-        VkShaderStageFlagBits stage, VkShaderModule& module, const char* entryName) const noexcept;
-    VkPipelineVertexInputStateCreateInfo CreatePipelineVertexInputStateCreateInfo() const noexcept;
-    VkPipelineInputAssemblyStateCreateInfo CreatePipelineInputAssemblyStateCreateInfo(
-        const VkPrimitiveTopology& topology, uint32_t restartEnable) const noexcept;
-    VkViewport CreateViewport() const noexcept;
-    VkRect2D CreateScissor() const noexcept;
-    VkPipelineViewportStateCreateInfo CreatePipelineViewportStateCreateInfo(
-        const VkViewport& viewport, const VkRect2D& scissor) const noexcept;
-    VkPipelineRasterizationStateCreateInfo CreatePipelineRasterizationStateCreateInfo() const noexcept;
-    VkPipelineMultisampleStateCreateInfo CreatePipelineMultisampleStateCreateInfo() const noexcept;
-    VkPipelineColorBlendAttachmentState CreatePipelineColorBlendAttachmentState() const noexcept;
-    VkPipelineColorBlendStateCreateInfo CreatePipelineColorBlendStateCreateInfo(
-        const VkPipelineColorBlendAttachmentState& colorBlendAttachment) const noexcept;
-    VkPipelineLayoutCreateInfo CreatePipelineLayoutCreateInfo() const noexcept;
-    VkGraphicsPipelineCreateInfo CreateGraphicsPipelineCreateInfo(
-        const VkPipelineShaderStageCreateInfo shaderStages[],
-        const VkPipelineVertexInputStateCreateInfo& vertexInputInfo,
-        const VkPipelineInputAssemblyStateCreateInfo& inputAssembly,
-        const VkPipelineViewportStateCreateInfo& viewportState,
-        const VkPipelineRasterizationStateCreateInfo& rasterizer,
-        const VkPipelineMultisampleStateCreateInfo& multisampling,
-        const VkPipelineColorBlendStateCreateInfo& colorBlending) const noexcept;
-    VkShaderModuleCreateInfo CreateShaderModuleCreateInfo(
-        const std::vector<char>& code) const noexcept;
-    VkFramebufferCreateInfo CreateFramebufferCreateInfo(
-        const VkImageView& attachments) const noexcept;
-    VkCommandPoolCreateInfo CreateCommandPoolCreateInfo(QueueFamilyIndices& queueFamilyIndices) const noexcept;
-    VkCommandBufferAllocateInfo CreateCommandBufferAllocateInfo() const noexcept;
-    VkCommandBufferBeginInfo CreateCommandBufferBeginInfo() const noexcept;
-    VkRenderPassBeginInfo CreateRenderPassBeginInfo(size_t swapchainBufferNumber,
-        const VkClearValue& clearValue) const noexcept;
-    VkSemaphoreCreateInfo CreateSemaphoreCreateInfo() const noexcept;
-    VkSubmitInfo CreateSubmitInfo(uint32_t imageIndex,
-		VkPipelineStageFlags* pipelineStageFlags) const noexcept;
-    VkPresentInfoKHR CreatePresentInfoKHR(uint32_t& imageIndex) const noexcept;
-    bool IsDeviceSuitable(const VkPhysicalDevice& device) const;
-    QueueFamilyIndices FindQueueFamilies(const VkPhysicalDevice& device) const;
-    bool CheckDeviceExtensionSupport(const VkPhysicalDevice& device) const;
+    VkPresentInfoKHR CreatePresentInfoKHR(const CanvasFrame& canvasFrame) const noexcept;
+    virtual bool IsDeviceSuitable(const VkPhysicalDevice& device) const override;
     SwapChainSupportDetails QuerySwapChainSupport(const VkPhysicalDevice& device) const;
     VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) const noexcept;
     VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) const noexcept;
+    uint32_t ChooseSwapImageCount(const VkSurfaceCapabilitiesKHR& capabilities) const noexcept;
     VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities, const wxSize& size) const noexcept;
-    static std::vector<char> ReadFile(const std::string& filename);
-    void CreateShaderModule(const std::vector<char>& code, VkShaderModule& shaderModule) const;
     virtual void OnPaint(wxPaintEvent& event);
     virtual void OnResize(wxSizeEvent& event);
     void OnPaintException(const std::string& msg);
 
-    VkInstance m_instance;
-    VkSurfaceKHR m_surface;
-    VkPhysicalDevice m_physicalDevice;
-    VkDevice m_logicalDevice;
-    VkQueue m_graphicsQueue;
-    VkQueue m_presentQueue;
     VkSwapchainKHR m_swapchain;
-    std::vector<VkImage> m_swapchainImages;
-    VkFormat m_swapchainImageFormat;
-    VkExtent2D m_swapchainExtent;
-    std::vector<VkImageView> m_swapchainImageViews;
-    VkRenderPass m_renderPass;
-    VkPipelineLayout m_pipelineLayout;
-    VkPipeline m_graphicsPipeline;
-    std::vector<VkFramebuffer> m_swapchainFramebuffers;
-    VkCommandPool m_commandPool;
-    std::vector<VkCommandBuffer> m_commandBuffers;
-    VkSemaphore m_imageAvailableSemaphore;
-    VkSemaphore m_renderFinishedSemaphore;
-    bool m_vulkanInitialized;
+    // formats and present modes of m_surface on each device QuerySwapChainSupport has been asked about
+    mutable std::map<VkPhysicalDevice, SwapChainSupportDetails> m_surfaceSupport;
+    PresentationPolicy m_presentationPolicy;
+    // chosen by ChooseSurfaceFormat; CreateSwapChain only reads it, as the pipeline may be
+    // compiling from m_imageFormat on a worker thread at the same time
+    VkSurfaceFormatKHR m_surfaceFormat;
+    VkPresentModeKHR m_presentMode;
+    bool m_renderOnPaint;
+    FrameCoordinator* m_coordinator;
 };
 
@@ -0,0 +1,490 @@
+#include "VulkanContext.h"
+#include "VulkanException.h"
+#include <algorithm>
+#include <limits>
+
+const std::string pipelineCacheFile = "pipeline_cache.bin";
+
+// puts features at the front of createInfo's pNext chain
+template<typename Features>
+static void ChainFeatures(VkDeviceCreateInfo& createInfo, Features& features) noexcept
+{
+    features.pNext = const_cast<void*>(createInfo.pNext);
+    createInfo.pNext = &features;
+}
+
+VulkanContext::VulkanContext()
+    : m_instance(VK_NULL_HANDLE), m_physicalDevice(VK_NULL_HANDLE), m_device(VK_NULL_HANDLE),
+    m_deviceOverride(DeviceSelector::GetEnvironmentOverride()), m_timelineSemaphoresRequested(false),
+    m_dynamicRenderingRequested(false), m_apiVersion(VK_API_VERSION_1_0), m_pipelineCache(pipelineCacheFile),
+    m_cmdBeginRendering(nullptr), m_cmdEndRendering(nullptr), m_getPhysicalDeviceFeatures2(nullptr),
+    m_getPhysicalDeviceProperties2(nullptr), m_waitSemaphores(nullptr), m_getSemaphoreCounterValue(nullptr), m_descriptorSetLayout(VK_NULL_HANDLE),
+    m_pipelineLayout(VK_NULL_HANDLE)
+{
+}
+
+VulkanContext::~VulkanContext() noexcept
+{
+    if (m_device != VK_NULL_HANDLE) {
+        vkDeviceWaitIdle(m_device);
+        // compiles still running use the shader modules and the pipeline cache
+        m_pipelineRegistry.Destroy();
+        DestroyPipelineLayout();
+        DestroyShaderModules();
+        m_pipelineCache.Destroy();
+        m_memoryAllocator.Destroy();
+        for (auto& timeline : m_timelines) {
+            vkDestroySemaphore(m_device, timeline.second.semaphore, nullptr);
+        }
+        vkDestroyDevice(m_device, nullptr);
+    }
+    if (m_instance != VK_NULL_HANDLE) {
+        vkDestroyInstance(m_instance, nullptr);
+    }
+}
+
+void VulkanContext::CreateInstance(const VkInstanceCreateInfo& createInfo)
+{
+    if (m_instance != VK_NULL_HANDLE) {
+        throw std::runtime_error("Programming Error:\nThe Vulkan context already has an instance.");
+    }
+    VkResult err = vkCreateInstance(&createInfo, nullptr, &m_instance);
+    if (err != VK_SUCCESS) {
+        throw VulkanException(err, "Unable to create a Vulkan instance:");
+    }
+    m_instanceExtensions.insert(createInfo.ppEnabledExtensionNames,
+        createInfo.ppEnabledExtensionNames + createInfo.enabledExtensionCount);
+    if (createInfo.pApplicationInfo != nullptr) {
+        m_apiVersion = createInfo.pApplicationInfo->apiVersion;
+    }
+    LoadInstanceFunctions();
+    m_deviceSelector.Probe(m_instance, m_getPhysicalDeviceProperties2);
+}
+
+void VulkanContext::LoadInstanceFunctions()
+{
+    if (m_apiVersion >= VK_API_VERSION_1_1) {
+        m_getPhysicalDeviceFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(
+            vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceFeatures2"));
+        m_getPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(
+            vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceProperties2"));
+    }
+    else if (m_instanceExtensions.count(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) != 0) {
+        m_getPhysicalDeviceProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(
+            vkGetInstanceProcAddr(m_instance, "vkGetPhysicalDeviceProperties2KHR"));
+    }
+}
+
+bool VulkanContext::LoadTimelineFunctions()
+{
+    m_waitSemaphores = reinterpret_cast<PFN_vkWaitSemaphores>(
+        vkGetDeviceProcAddr(m_device, "vkWaitSemaphores"));
+    m_getSemaphoreCounterValue = reinterpret_cast<PFN_vkGetSemaphoreCounterValue>(
+        vkGetDeviceProcAddr(m_device, "vkGetSemaphoreCounterValue"));
+    if (m_waitSemaphores == nullptr || m_getSemaphoreCounterValue == nullptr) {
+        m_waitSemaphores = nullptr;
+        m_getSemaphoreCounterValue = nullptr;
+        return false;
+    }
+    return true;
+}
+
+uint32_t VulkanContext::ChooseApiVersion() const
+{
+    uint32_t wanted = VK_API_VERSION_1_0;
+    if (m_dynamicRenderingRequested) {
+        wanted = VK_API_VERSION_1_3;
+    }
+    else if (m_timelineSemaphoresRequested) {
+        wanted = VK_API_VERSION_1_2;
+    }
+    if (wanted == VK_API_VERSION_1_0) {
+        return wanted;
+    }
+    // a Vulkan 1.0 loader does not have vkEnumerateInstanceVersion
+    auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+        vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr && enumerateInstanceVersion(&loaderVersion) != VK_SUCCESS) {
+        loaderVersion = VK_API_VERSION_1_0;
+    }
+    if (loaderVersion >= wanted) {
+        return wanted;
+    }
+    // on 1.2, dynamic rendering is still available as an extension
+    return loaderVersion >= VK_API_VERSION_1_2 ? VK_API_VERSION_1_2 : VK_API_VERSION_1_0;
+}
+
+bool VulkanContext::SupportsTimelineSemaphores(VkPhysicalDevice physicalDevice) const
+{
+    if (m_apiVersion < VK_API_VERSION_1_2 || m_getPhysicalDeviceFeatures2 == nullptr ||
+        m_deviceSelector.GetInfo(physicalDevice).properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &features12;
+    m_getPhysicalDeviceFeatures2(physicalDevice, &features);
+    return features12.timelineSemaphore == VK_TRUE;
+}
+
+bool VulkanContext::HasCoreDynamicRendering(VkPhysicalDevice physicalDevice) const
+{
+    return m_apiVersion >= VK_API_VERSION_1_3 &&
+        m_deviceSelector.GetInfo(physicalDevice).properties.apiVersion >= VK_API_VERSION_1_3;
+}
+
+bool VulkanContext::SupportsDynamicRendering(VkPhysicalDevice physicalDevice) const
+{
+    // the extension depends on VK_KHR_create_renderpass2 and VK_KHR_depth_stencil_resolve, core in 1.2
+    const PhysicalDeviceInfo& info = m_deviceSelector.GetInfo(physicalDevice);
+    if (m_apiVersion < VK_API_VERSION_1_2 || m_getPhysicalDeviceFeatures2 == nullptr ||
+        info.properties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
+    }
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    if (HasCoreDynamicRendering(physicalDevice)) {
+        VkPhysicalDeviceVulkan13Features features13 = {};
+        features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        features.pNext = &features13;
+        m_getPhysicalDeviceFeatures2(physicalDevice, &features);
+        return features13.dynamicRendering == VK_TRUE;
+    }
+    if (info.extensions.count(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) == 0) {
+        return false;
+    }
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    features.pNext = &dynamicRenderingFeatures;
+    m_getPhysicalDeviceFeatures2(physicalDevice, &features);
+    return dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+}
+
+void VulkanContext::CreateLogicalDevice(const VkDeviceCreateInfo& createInfo, const std::set<int>& queueFamilies)
+{
+    VkDeviceCreateInfo deviceInfo = createInfo;
+    std::vector<const char*> extensions(createInfo.ppEnabledExtensionNames,
+        createInfo.ppEnabledExtensionNames + createInfo.enabledExtensionCount);
+    VkPhysicalDeviceVulkan12Features features12 = {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    VkPhysicalDeviceVulkan13Features features13 = {};
+    features13.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures = {};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+    bool timelineSemaphores = m_timelineSemaphoresRequested && SupportsTimelineSemaphores(m_physicalDevice);
+    if (timelineSemaphores) {
+        features12.timelineSemaphore = VK_TRUE;
+        ChainFeatures(deviceInfo, features12);
+    }
+    bool dynamicRendering = m_dynamicRenderingRequested && SupportsDynamicRendering(m_physicalDevice);
+    bool coreDynamicRendering = dynamicRendering && HasCoreDynamicRendering(m_physicalDevice);
+    if (coreDynamicRendering) {
+        features13.dynamicRendering = VK_TRUE;
+        ChainFeatures(deviceInfo, features13);
+    }
+    else if (dynamicRendering) {
+        dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+        ChainFeatures(deviceInfo, dynamicRenderingFeatures);
+        extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    }
+    deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    deviceInfo.ppEnabledExtensionNames = extensions.data();
+
+    VkResult result = vkCreateDevice(m_physicalDevice, &deviceInfo, nullptr, &m_device);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Unable to create a logical device");
+    }
+    m_deviceExtensions.insert(extensions.begin(), extensions.end());
+    for (int family : queueFamilies) {
+        VkQueue queue;
+        vkGetDeviceQueue(m_device, family, 0, &queue);
+        m_queues[family] = queue;
+    }
+    // without the commands the feature goes unused, and fences and binary semaphores are used instead
+    if (timelineSemaphores && LoadTimelineFunctions()) {
+        CreateTimelines();
+    }
+    if (dynamicRendering) {
+        LoadDynamicRenderingFunctions(coreDynamicRendering);
+    }
+}
+
+void VulkanContext::LoadDynamicRenderingFunctions(bool core)
+{
+    // the loader does not export extension commands
+    m_cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRendering>(
+        vkGetDeviceProcAddr(m_device, core ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+    m_cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRendering>(
+        vkGetDeviceProcAddr(m_device, core ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+    if (m_cmdBeginRendering == nullptr || m_cmdEndRendering == nullptr) {
+        m_cmdBeginRendering = nullptr;
+        m_cmdEndRendering = nullptr;
+        throw std::runtime_error("The Vulkan device enabled dynamic rendering but does not provide its commands.");
+    }
+}
+
+VkSemaphoreCreateInfo VulkanContext::CreateTimelineSemaphoreCreateInfo(VkSemaphoreTypeCreateInfo& typeInfo) const noexcept
+{
+    typeInfo = {};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+    return semaphoreInfo;
+}
+
+void VulkanContext::CreateTimelines()
+{
+    VkSemaphoreTypeCreateInfo typeInfo;
+    VkSemaphoreCreateInfo semaphoreInfo = CreateTimelineSemaphoreCreateInfo(typeInfo);
+    for (const auto& queue : m_queues) {
+        // families that share a queue share its timeline
+        if (m_timelines.count(queue.second) != 0) {
+            continue;
+        }
+        QueueTimeline timeline;
+        VkResult result = vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &timeline.semaphore);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create a queue timeline semaphore:");
+        }
+        m_timelines[queue.second] = timeline;
+    }
+}
+
+void VulkanContext::CreatePipelineCache()
+{
+    m_pipelineCache.Create(m_device, m_physicalDevice);
+    m_pipelineRegistry.Create(m_device, m_pipelineCache);
+}
+
+void VulkanContext::CreateMemoryAllocator()
+{
+    m_memoryAllocator.Create(m_device, m_physicalDevice);
+}
+
+bool VulkanContext::HasInstanceExtensions(const std::vector<const char*>& names) const
+{
+    for (const char* name : names) {
+        if (m_instanceExtensions.count(name) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool VulkanContext::HasDeviceExtensions(const std::vector<const char*>& names) const
+{
+    for (const char* name : names) {
+        if (m_deviceExtensions.count(name) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VkQueue VulkanContext::GetQueue(int family) const noexcept
+{
+    auto iter = m_queues.find(family);
+    return iter == m_queues.end() ? VK_NULL_HANDLE : iter->second;
+}
+
+void VulkanContext::LoadShaders(const std::vector<std::string>& names)
+{
+    std::lock_guard<std::mutex> lock(m_shaderMutex);
+    if (!m_shaderProvider) {
+        m_shaderProvider = ShaderBinaryProvider::Create();
+    }
+    for (const auto& name : names) {
+        m_shaderProvider->GetShader(name);
+    }
+}
+
+VkShaderModuleCreateInfo VulkanContext::CreateShaderModuleCreateInfo(const ShaderBinary& code) const noexcept
+{
+    VkShaderModuleCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size;
+    createInfo.pCode = code.code;
+    return createInfo;
+}
+
+VkShaderModule VulkanContext::GetShaderModule(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(m_shaderMutex);
+    auto iter = m_shaderModules.find(name);
+    if (iter == m_shaderModules.end()) {
+        if (!m_shaderProvider) {
+            m_shaderProvider = ShaderBinaryProvider::Create();
+        }
+        VkShaderModuleCreateInfo createInfo = CreateShaderModuleCreateInfo(m_shaderProvider->GetShader(name));
+        VkShaderModule shaderModule;
+        VkResult result = vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create shader module:");
+        }
+        iter = m_shaderModules.insert({ name, shaderModule }).first;
+    }
+    return iter->second;
+}
+
+VkPipelineLayoutCreateInfo VulkanContext::CreatePipelineLayoutCreateInfo(
+    const VkPushConstantRange& pushConstantRange) const noexcept
+{
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    return pipelineLayoutInfo;
+}
+
+void VulkanContext::CreatePipelineLayout(const VkDescriptorSetLayoutCreateInfo& setLayoutInfo,
+    const VkPushConstantRange& pushConstantRange)
+{
+    std::lock_guard<std::mutex> lock(m_layoutMutex);
+    if (m_pipelineLayout != VK_NULL_HANDLE) {
+        return;
+    }
+    VkResult result = vkCreateDescriptorSetLayout(m_device, &setLayoutInfo, nullptr, &m_descriptorSetLayout);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to create the descriptor set layout:");
+    }
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = CreatePipelineLayoutCreateInfo(pushConstantRange);
+    result = vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_pipelineLayout);
+    if (result != VK_SUCCESS) {
+        vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+        m_descriptorSetLayout = VK_NULL_HANDLE;
+        throw VulkanException(result, "Failed to create pipeline layout:");
+    }
+}
+
+void VulkanContext::DestroyPipelineLayout() noexcept
+{
+    if (m_pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_device, m_pipelineLayout, nullptr);
+        m_pipelineLayout = VK_NULL_HANDLE;
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(m_device, m_descriptorSetLayout, nullptr);
+        m_descriptorSetLayout = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanContext::DestroyShaderModules() noexcept
+{
+    for (auto& shaderModule : m_shaderModules) {
+        vkDestroyShaderModule(m_device, shaderModule.second, nullptr);
+    }
+    m_shaderModules.clear();
+}
+
+SubmitPoint VulkanContext::BeginSubmit(VkQueue queue, VkFence fence)
+{
+    SubmitPoint point;
+    auto iter = m_timelines.find(queue);
+    if (iter != m_timelines.end()) {
+        point.timeline = iter->second.semaphore;
+        point.value = ++iter->second.value;
+        return point;
+    }
+    if (fence == VK_NULL_HANDLE) {
+        throw std::runtime_error("Programming Error:\nA submission without timeline semaphores needs a fence.");
+    }
+    VkResult result = vkResetFences(m_device, 1, &fence);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to reset a submission fence:");
+    }
+    point.fence = fence;
+    return point;
+}
+
+void VulkanContext::CancelSubmit(VkQueue queue, const SubmitPoint& point) noexcept
+{
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    SubmitWaits noWaits;
+    TimelineSubmit timelineSubmit;
+    timelineSubmit.Apply(submitInfo, noWaits, point);
+    // if this fails as well the device is most likely lost, and waits return rather than hang
+    vkQueueSubmit(queue, 1, &submitInfo, point.fence);
+}
+
+VkSemaphoreWaitInfo VulkanContext::CreateSemaphoreWaitInfo(uint32_t count, const VkSemaphore* semaphores,
+    const uint64_t* values) const noexcept
+{
+    VkSemaphoreWaitInfo waitInfo = {};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = count;
+    waitInfo.pSemaphores = semaphores;
+    waitInfo.pValues = values;
+    return waitInfo;
+}
+
+VkResult VulkanContext::Wait(const SubmitPoint& point) const noexcept
+{
+    if (point.timeline != VK_NULL_HANDLE) {
+        VkSemaphoreWaitInfo waitInfo = CreateSemaphoreWaitInfo(1, &point.timeline, &point.value);
+        return m_waitSemaphores(m_device, &waitInfo, std::numeric_limits<uint64_t>::max());
+    }
+    if (point.fence != VK_NULL_HANDLE) {
+        return vkWaitForFences(m_device, 1, &point.fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+    }
+    return VK_SUCCESS;
+}
+
+VkResult VulkanContext::Wait(const std::vector<SubmitPoint>& points) const noexcept
+{
+    std::vector<VkFence> fences;
+    std::vector<VkSemaphore> semaphores;
+    std::vector<uint64_t> values;
+    for (const auto& point : points) {
+        if (point.timeline != VK_NULL_HANDLE) {
+            // only the highest value on each timeline matters
+            auto iter = std::find(semaphores.begin(), semaphores.end(), point.timeline);
+            if (iter == semaphores.end()) {
+                semaphores.push_back(point.timeline);
+                values.push_back(point.value);
+            }
+            else {
+                uint64_t& value = values[iter - semaphores.begin()];
+                value = std::max(value, point.value);
+            }
+        }
+        // several points can share one fence
+        else if (point.fence != VK_NULL_HANDLE && std::find(fences.begin(), fences.end(), point.fence) == fences.end()) {
+            fences.push_back(point.fence);
+        }
+    }
+    if (!semaphores.empty()) {
+        VkSemaphoreWaitInfo waitInfo = CreateSemaphoreWaitInfo(static_cast<uint32_t>(semaphores.size()),
+            semaphores.data(), values.data());
+        VkResult result = m_waitSemaphores(m_device, &waitInfo, std::numeric_limits<uint64_t>::max());
+        if (result != VK_SUCCESS) {
+            return result;
+        }
+    }
+    if (!fences.empty()) {
+        return vkWaitForFences(m_device, static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE,
+            std::numeric_limits<uint64_t>::max());
+    }
+    return VK_SUCCESS;
+}
+
+bool VulkanContext::IsComplete(const SubmitPoint& point) const noexcept
+{
+    if (point.timeline != VK_NULL_HANDLE) {
+        uint64_t value = 0;
+        return m_getSemaphoreCounterValue(m_device, point.timeline, &value) == VK_SUCCESS && value >= point.value;
+    }
+    if (point.fence != VK_NULL_HANDLE) {
+        return vkGetFenceStatus(m_device, point.fence) == VK_SUCCESS;
+    }
+    return true;
+}
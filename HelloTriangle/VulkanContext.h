@@ -0,0 +1,168 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "DeviceMemoryAllocator.h"
+#include "DeviceSelector.h"
+#include "PipelineCache.h"
+#include "PipelineRegistry.h"
+#include "QueueSubmission.h"
+#include "ShaderBinaryProvider.h"
+
+// The Vulkan objects that do not belong to any one view: instance, physical and logical device,
+// queues, device memory, pipeline cache, pipelines, their layout and shader modules. Renderers hold the context
+// through a shared_ptr; the first renderer creates its objects and the last one to be destroyed
+// releases them, so several canvases can share one device and its memory.
+//
+// Frame pacing and queue to queue dependencies use fences and binary semaphores unless timeline
+// semaphores are requested and both the loader and the device support Vulkan 1.2. Then each
+// queue gets one timeline semaphore, every submission signals the queue's next value on it, and
+// the CPU waits for values with vkWaitSemaphores instead of waiting for and resetting fences.
+// Swapchain acquire and present always use binary semaphores.
+//
+// Likewise, renderers draw through a VkRenderPass and framebuffers unless dynamic rendering is
+// requested and the device has it, either as core Vulkan 1.3 or through VK_KHR_dynamic_rendering
+// on Vulkan 1.2. Then they render straight into their image views.
+class VulkanContext
+{
+public:
+    VulkanContext();
+    virtual ~VulkanContext() noexcept;
+
+    // Index or UUID of the device to use instead of the highest scoring one; see DeviceSelector.
+    // Defaults to the VULKAN_DEVICE environment variable and must be set before the device is picked.
+    void SetDeviceOverride(const std::string& deviceOverride) { m_deviceOverride = deviceOverride; }
+    const std::string& GetDeviceOverride() const noexcept { return m_deviceOverride; }
+    // Must be set before the instance is created. Ignored where Vulkan 1.2 is not available.
+    void SetTimelineSemaphoresRequested(bool requested) noexcept { m_timelineSemaphoresRequested = requested; }
+    bool GetTimelineSemaphoresRequested() const noexcept { return m_timelineSemaphoresRequested; }
+    // Must be set before the instance is created. Ignored where neither Vulkan 1.3 nor
+    // VK_KHR_dynamic_rendering on Vulkan 1.2 is available.
+    void SetDynamicRenderingRequested(bool requested) noexcept { m_dynamicRenderingRequested = requested; }
+    bool GetDynamicRenderingRequested() const noexcept { return m_dynamicRenderingRequested; }
+    // The apiVersion for the instance: 1.3 if dynamic rendering is requested, 1.2 if only timeline
+    // semaphores are, and 1.0 otherwise, but never newer than the loader supports.
+    uint32_t ChooseApiVersion() const;
+
+    // Done once, by the first renderer to use the context. Also probes the physical devices.
+    void CreateInstance(const VkInstanceCreateInfo& createInfo);
+    void SetPhysicalDevice(VkPhysicalDevice physicalDevice) noexcept { m_physicalDevice = physicalDevice; }
+    // Creates the device with one queue in each of queueFamilies, enabling timeline semaphores
+    // and dynamic rendering if they were requested and the device supports them.
+    void CreateLogicalDevice(const VkDeviceCreateInfo& createInfo, const std::set<int>& queueFamilies);
+    // Also readies the pipeline registry, which compiles through the cache.
+    void CreatePipelineCache();
+    void CreateMemoryAllocator();
+    // Reads and validates the SPIR-V; needs no device, so it can run before the device exists.
+    void LoadShaders(const std::vector<std::string>& names);
+
+    bool IsDeviceCreated() const noexcept { return m_device != VK_NULL_HANDLE; }
+    bool HasInstanceExtensions(const std::vector<const char*>& names) const;
+    bool HasDeviceExtensions(const std::vector<const char*>& names) const;
+    bool SupportsTimelineSemaphores(VkPhysicalDevice physicalDevice) const;
+    // true once a device has been created with timeline semaphores
+    bool UsesTimelineSemaphores() const noexcept { return !m_timelines.empty(); }
+    bool SupportsDynamicRendering(VkPhysicalDevice physicalDevice) const;
+    // true once a device has been created with dynamic rendering
+    bool UsesDynamicRendering() const noexcept { return m_cmdBeginRendering != nullptr; }
+    // vkCmdBeginRendering or vkCmdBeginRenderingKHR, whichever the device has; only with dynamic rendering
+    void CmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo& renderingInfo) const noexcept
+    {
+        m_cmdBeginRendering(commandBuffer, &renderingInfo);
+    }
+    void CmdEndRendering(VkCommandBuffer commandBuffer) const noexcept { m_cmdEndRendering(commandBuffer); }
+    VkInstance GetInstance() const noexcept { return m_instance; }
+    VkPhysicalDevice GetPhysicalDevice() const noexcept { return m_physicalDevice; }
+    const DeviceSelector& GetDeviceSelector() const noexcept { return m_deviceSelector; }
+    VkDevice GetDevice() const noexcept { return m_device; }
+    // VK_NULL_HANDLE if the device has no queue in family
+    VkQueue GetQueue(int family) const noexcept;
+    PipelineCache& GetPipelineCache() noexcept { return m_pipelineCache; }
+    const PipelineCache& GetPipelineCache() const noexcept { return m_pipelineCache; }
+    PipelineRegistry& GetPipelineRegistry() noexcept { return m_pipelineRegistry; }
+    const PipelineRegistry& GetPipelineRegistry() const noexcept { return m_pipelineRegistry; }
+    DeviceMemoryAllocator& GetMemoryAllocator() noexcept { return m_memoryAllocator; }
+    const DeviceMemoryAllocator& GetMemoryAllocator() const noexcept { return m_memoryAllocator; }
+    // Modules are created on first use and kept until the context is destroyed. May be called
+    // from several threads.
+    VkShaderModule GetShaderModule(const std::string& name);
+    // Every renderer draws with the same descriptor set layout and pipeline layout, so they belong
+    // to the context and the pipeline registry finds one renderer's pipelines for the others. The
+    // first call creates them; later calls must describe the same layouts and do nothing. May be
+    // called from several threads.
+    void CreatePipelineLayout(const VkDescriptorSetLayoutCreateInfo& setLayoutInfo,
+        const VkPushConstantRange& pushConstantRange);
+    VkDescriptorSetLayout GetDescriptorSetLayout() const noexcept { return m_descriptorSetLayout; }
+    VkPipelineLayout GetPipelineLayout() const noexcept { return m_pipelineLayout; }
+
+    // Call immediately before submitting to queue, and submit with the returned point's fence.
+    // With timeline semaphores, returns the queue's next timeline value, which the submission must
+    // signal (see TimelineSubmit); otherwise resets fence and returns it.
+    SubmitPoint BeginSubmit(VkQueue queue, VkFence fence);
+    // Call when the submission that BeginSubmit returned point for could not be made. Submits an
+    // empty batch that completes point instead, so that nothing waits forever on a reset fence or
+    // on a timeline value that was never signaled.
+    void CancelSubmit(VkQueue queue, const SubmitPoint& point) noexcept;
+    // Null points are complete.
+    VkResult Wait(const SubmitPoint& point) const noexcept;
+    VkResult Wait(const std::vector<SubmitPoint>& points) const noexcept;
+    bool IsComplete(const SubmitPoint& point) const noexcept;
+
+private:
+    struct QueueTimeline {
+        VkSemaphore semaphore = VK_NULL_HANDLE;
+        // the value signaled by the queue's most recent submission
+        uint64_t value = 0;
+    };
+
+    VkShaderModuleCreateInfo CreateShaderModuleCreateInfo(const ShaderBinary& code) const noexcept;
+    VkPipelineLayoutCreateInfo CreatePipelineLayoutCreateInfo(
+        const VkPushConstantRange& pushConstantRange) const noexcept;
+    VkSemaphoreCreateInfo CreateTimelineSemaphoreCreateInfo(VkSemaphoreTypeCreateInfo& typeInfo) const noexcept;
+    VkSemaphoreWaitInfo CreateSemaphoreWaitInfo(uint32_t count, const VkSemaphore* semaphores,
+        const uint64_t* values) const noexcept;
+    void CreateTimelines();
+    bool HasCoreDynamicRendering(VkPhysicalDevice physicalDevice) const;
+    void LoadDynamicRenderingFunctions(bool core);
+    // Vulkan 1.1 and 1.2 commands are looked up rather than linked, so that the program still
+    // starts with a 1.0 loader and falls back to fences and binary semaphores.
+    void LoadInstanceFunctions();
+    bool LoadTimelineFunctions();
+    void DestroyShaderModules() noexcept;
+    void DestroyPipelineLayout() noexcept;
+
+    VkInstance m_instance;
+    VkPhysicalDevice m_physicalDevice;
+    VkDevice m_device;
+    DeviceSelector m_deviceSelector;
+    std::string m_deviceOverride;
+    bool m_timelineSemaphoresRequested;
+    bool m_dynamicRenderingRequested;
+    uint32_t m_apiVersion;
+    std::set<std::string> m_instanceExtensions;
+    std::set<std::string> m_deviceExtensions;
+    std::map<int, VkQueue> m_queues;
+    std::map<VkQueue, QueueTimeline> m_timelines;
+    PFN_vkCmdBeginRendering m_cmdBeginRendering;
+    PFN_vkCmdEndRendering m_cmdEndRendering;
+    // null where the instance is older than 1.1
+    PFN_vkGetPhysicalDeviceFeatures2 m_getPhysicalDeviceFeatures2;
+    // the KHR alias on a 1.0 instance with VK_KHR_get_physical_device_properties2
+    PFN_vkGetPhysicalDeviceProperties2 m_getPhysicalDeviceProperties2;
+    // only with timeline semaphores
+    PFN_vkWaitSemaphores m_waitSemaphores;
+    PFN_vkGetSemaphoreCounterValue m_getSemaphoreCounterValue;
+    PipelineCache m_pipelineCache;
+    PipelineRegistry m_pipelineRegistry;
+    DeviceMemoryAllocator m_memoryAllocator;
+    std::mutex m_shaderMutex;
+    std::unique_ptr<ShaderBinaryProvider> m_shaderProvider;
+    std::map<std::string, VkShaderModule> m_shaderModules;
+    std::mutex m_layoutMutex;
+    VkDescriptorSetLayout m_descriptorSetLayout;
+    VkPipelineLayout m_pipelineLayout;
+};
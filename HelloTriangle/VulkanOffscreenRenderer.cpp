@@ -0,0 +1,255 @@
+#include "VulkanOffscreenRenderer.h"
+#include "VulkanException.h"
+#include <cstring>
+#include <limits>
+
+VulkanOffscreenRenderer::VulkanOffscreenRenderer(uint32_t width, uint32_t height,
+    bool enableReadback, uint32_t imageCount, std::shared_ptr<VulkanContext> context)
+    : VulkanRenderer(context), m_readbackEnabled(enableReadback),
+    m_nextImage(0), m_lastImage(-1), m_frameCount(0)
+{
+    if (width == 0 || height == 0 || imageCount == 0) {
+        throw std::runtime_error("Programming Error:\n"
+            "Offscreen rendering requires a non-empty extent and at least one image.");
+    }
+    m_imageFormat = OFFSCREEN_FORMAT;
+    m_extent = { width, height };
+    // the images are copied out rather than presented
+    m_finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    // see VulkanCanvas: shaders, the pipeline cache and the pipeline are prepared on worker threads
+    typedef InitScheduler::Thread Thread;
+    InitScheduler scheduler;
+    std::vector<std::string> pipelineDependencies = { "CreateRenderPass", "CreateDescriptorSetLayout" };
+    if (!m_context->IsDeviceCreated()) {
+        scheduler.Add("LoadShaders", Thread::Worker, [&] { LoadShaders({ "vert.spv", "frag.spv" }); });
+        scheduler.Add("CreateInstance", Thread::Caller, [&] { InitializeInstance("VulkanOffscreen", {}); });
+        scheduler.Add("PickPhysicalDevice", Thread::Caller, [&] { PickPhysicalDevice(); });
+        scheduler.Add("CreateLogicalDevice", Thread::Caller, [&] { CreateLogicalDevice(); });
+        scheduler.Add("CreatePipelineCache", Thread::Worker, [&] { CreatePipelineCache(); },
+            { "CreateLogicalDevice" });
+        scheduler.Add("CreateMemoryAllocator", Thread::Caller, [&] { CreateMemoryAllocator(); });
+        pipelineDependencies.push_back("LoadShaders");
+        pipelineDependencies.push_back("CreatePipelineCache");
+    }
+    else {
+        scheduler.Add("AttachContext", Thread::Caller, [&] { AttachContext({}); });
+    }
+    scheduler.Add("CreateStagingUploader", Thread::Caller, [&] { CreateStagingUploader(); });
+    scheduler.Add("CreateRenderPass", Thread::Caller, [&] { CreateRenderPass(); });
+    scheduler.Add("CreateDescriptorSetLayout", Thread::Caller, [&] { CreateDescriptorSetLayout(); });
+    scheduler.Add("CreateGraphicsPipeline", Thread::Worker,
+        [&] { CreateGraphicsPipeline("vert.spv", "frag.spv"); }, pipelineDependencies);
+    scheduler.Add("CreateOffscreenImages", Thread::Caller, [&] { CreateOffscreenImages(imageCount); });
+    scheduler.Add("CreateImageViews", Thread::Caller, [&] { CreateImageViews(); });
+    scheduler.Add("CreateFrameBuffers", Thread::Caller, [&] { CreateFrameBuffers(); });
+    scheduler.Add("CreateCommandBuffers", Thread::Caller, [&] { CreateCommandBuffers(); });
+    scheduler.Add("CreateSyncObjects", Thread::Caller, [&] { CreateSyncObjects(); });
+    scheduler.Add("CreateTimestampQueries", Thread::Caller, [&] { CreateTimestampQueries(); });
+    scheduler.Add("CreateMeshBuffers", Thread::Caller, [&] { CreateMeshBuffers(); });
+    scheduler.Add("CreateFrameArena", Thread::Caller, [&] { CreateFrameArena(); });
+    scheduler.Add("CreateDescriptorSets", Thread::Caller, [&] { CreateDescriptorSets(); });
+    if (m_readbackEnabled) {
+        scheduler.Add("CreateReadbackBuffers", Thread::Caller, [&] { CreateReadbackBuffers(); });
+    }
+    RunInitSteps(scheduler);
+}
+
+
+VulkanOffscreenRenderer::~VulkanOffscreenRenderer() noexcept
+{
+    if (m_logicalDevice != VK_NULL_HANDLE) {
+        m_context->Wait(GetFramesInFlight());
+        m_deletionQueue.Flush();
+        DestroyFrameBuffers();
+        DestroyImageViews();
+        for (auto& image : m_images) {
+            vkDestroyImage(m_logicalDevice, image, nullptr);
+        }
+        for (auto& allocation : m_imageMemory) {
+            m_context->GetMemoryAllocator().Free(allocation);
+        }
+        for (auto& buffer : m_readbackBuffers) {
+            m_context->GetMemoryAllocator().DestroyBuffer(buffer);
+        }
+    }
+}
+
+VkImageCreateInfo VulkanOffscreenRenderer::CreateImageCreateInfo() const noexcept
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = m_imageFormat;
+    imageInfo.extent = { m_extent.width, m_extent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    return imageInfo;
+}
+
+void VulkanOffscreenRenderer::CreateOffscreenImages(uint32_t imageCount)
+{
+    VkImageCreateInfo imageInfo = CreateImageCreateInfo();
+    m_images.resize(imageCount, VK_NULL_HANDLE);
+    m_imageMemory.resize(imageCount);
+    for (uint32_t i = 0; i < imageCount; i++) {
+        VkResult result = vkCreateImage(m_logicalDevice, &imageInfo, nullptr, &m_images[i]);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create an offscreen image:");
+        }
+        m_imageMemory[i] = m_context->GetMemoryAllocator().AllocateImageMemory(m_images[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    }
+}
+
+VkDeviceSize VulkanOffscreenRenderer::GetImageSize() const noexcept
+{
+    // OFFSCREEN_FORMAT is four bytes per pixel
+    return static_cast<VkDeviceSize>(m_extent.width) * m_extent.height * 4;
+}
+
+void VulkanOffscreenRenderer::CreateReadbackBuffers()
+{
+    m_readbackBuffers.resize(m_images.size());
+    for (size_t i = 0; i < m_images.size(); i++) {
+        // cached memory makes the CPU reads in ReadLastFrame much faster where it is available
+        m_readbackBuffers[i] = m_context->GetMemoryAllocator().CreateBuffer(GetImageSize(), VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            VK_MEMORY_PROPERTY_HOST_CACHED_BIT);
+    }
+}
+
+VkImageMemoryBarrier VulkanOffscreenRenderer::CreateReadbackImageBarrier(uint32_t imageIndex) const noexcept
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_images[imageIndex];
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
+
+VkBufferMemoryBarrier VulkanOffscreenRenderer::CreateReadbackBufferBarrier(uint32_t imageIndex) const noexcept
+{
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = m_readbackBuffers[imageIndex].buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    return barrier;
+}
+
+VkBufferImageCopy VulkanOffscreenRenderer::CreateBufferImageCopy() const noexcept
+{
+    VkBufferImageCopy region = {};
+    region.bufferOffset = 0;
+    region.bufferRowLength = 0;
+    region.bufferImageHeight = 0;
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.mipLevel = 0;
+    region.imageSubresource.baseArrayLayer = 0;
+    region.imageSubresource.layerCount = 1;
+    region.imageOffset = { 0, 0, 0 };
+    region.imageExtent = { m_extent.width, m_extent.height, 1 };
+    return region;
+}
+
+void VulkanOffscreenRenderer::RecordAfterRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    if (!m_readbackEnabled) {
+        return;
+    }
+    VkImageMemoryBarrier imageBarrier = CreateReadbackImageBarrier(imageIndex);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+    VkBufferImageCopy region = CreateBufferImageCopy();
+    vkCmdCopyImageToBuffer(commandBuffer, m_images[imageIndex], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        m_readbackBuffers[imageIndex].buffer, 1, &region);
+
+    VkBufferMemoryBarrier bufferBarrier = CreateReadbackBufferBarrier(imageIndex);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+}
+
+VkSubmitInfo VulkanOffscreenRenderer::CreateSubmitInfo(const FrameData& frame, const SubmitWaits& waits) const noexcept
+{
+    // nothing is acquired or presented; the only waits are for staging uploads
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waits.semaphores.size());
+    submitInfo.pWaitSemaphores = waits.semaphores.data();
+    submitInfo.pWaitDstStageMask = waits.stages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.commandBuffer;
+    return submitInfo;
+}
+
+void VulkanOffscreenRenderer::RenderFrame()
+{
+    FrameData& frame = m_frames[m_currentFrame];
+    WaitForSubmit(frame.submitted);
+    m_frameProfiler.CollectGpuResults(static_cast<uint32_t>(m_currentFrame));
+
+    uint32_t imageIndex = m_nextImage;
+    m_nextImage = (m_nextImage + 1) % m_images.size();
+    WaitForSubmit(m_imagesInFlight[imageIndex]);
+
+    SubmitWaits waits;
+    {
+        StageTimer timer(m_frameProfiler, FrameStage::Record);
+        RecordCommandBuffer(frame, imageIndex, waits);
+    }
+
+    VkSubmitInfo submitInfo = CreateSubmitInfo(frame, waits);
+    SubmitPoint point = m_context->BeginSubmit(m_graphicsQueue, frame.inFlightFence);
+    TimelineSubmit timelineSubmit;
+    timelineSubmit.Apply(submitInfo, waits, point);
+    VkResult result;
+    {
+        StageTimer timer(m_frameProfiler, FrameStage::Submit);
+        result = vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, point.fence);
+    }
+    if (result != VK_SUCCESS) {
+        m_context->CancelSubmit(m_graphicsQueue, point);
+        throw VulkanException(result, "Failed to submit offscreen draw command buffer:");
+    }
+    frame.submitted = point;
+    m_imagesInFlight[imageIndex] = point;
+    m_currentFrame = (m_currentFrame + 1) % m_frames.size();
+    m_lastImage = imageIndex;
+    ++m_frameCount;
+}
+
+void VulkanOffscreenRenderer::ReadLastFrame(std::vector<uint8_t>& pixels)
+{
+    if (!m_readbackEnabled) {
+        throw std::runtime_error("Programming Error:\n"
+            "Attempted to read back an offscreen frame without enabling readback.");
+    }
+    if (m_lastImage < 0) {
+        throw std::runtime_error("Programming Error:\n"
+            "Attempted to read back an offscreen frame before one was rendered.");
+    }
+    size_t imageIndex = static_cast<size_t>(m_lastImage);
+    WaitForSubmit(m_imagesInFlight[imageIndex]);
+    pixels.resize(static_cast<size_t>(GetImageSize()));
+    std::memcpy(pixels.data(), m_readbackBuffers[imageIndex].allocation.mappedData, pixels.size());
+}
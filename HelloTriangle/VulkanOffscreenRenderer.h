@@ -0,0 +1,44 @@
+#pragma once
+#include "VulkanRenderer.h"
+#include <cstdint>
+#include <vector>
+
+// Renders the same render pass and pipeline as VulkanCanvas into device-local images
+// instead of a swapchain. No window or surface is needed, so this runs on machines
+// without a display, including GPU-less servers using a software driver such as lavapipe.
+class VulkanOffscreenRenderer :
+    public VulkanRenderer
+{
+public:
+    static const uint32_t DEFAULT_IMAGE_COUNT = 3;
+    static const VkFormat OFFSCREEN_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+
+    VulkanOffscreenRenderer(uint32_t width, uint32_t height,
+        bool enableReadback = false,
+        uint32_t imageCount = DEFAULT_IMAGE_COUNT,
+        std::shared_ptr<VulkanContext> context = nullptr);
+    virtual ~VulkanOffscreenRenderer() noexcept;
+
+    void RenderFrame();
+    void ReadLastFrame(std::vector<uint8_t>& pixels);
+    uint64_t GetFrameCount() const noexcept { return m_frameCount; }
+    VkExtent2D GetExtent() const noexcept { return m_extent; }
+
+private:
+    void CreateOffscreenImages(uint32_t imageCount);
+    void CreateReadbackBuffers();
+    virtual void RecordAfterRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex) override;
+    VkImageCreateInfo CreateImageCreateInfo() const noexcept;
+    VkImageMemoryBarrier CreateReadbackImageBarrier(uint32_t imageIndex) const noexcept;
+    VkBufferMemoryBarrier CreateReadbackBufferBarrier(uint32_t imageIndex) const noexcept;
+    VkBufferImageCopy CreateBufferImageCopy() const noexcept;
+    VkSubmitInfo CreateSubmitInfo(const FrameData& frame, const SubmitWaits& waits) const noexcept;
+    VkDeviceSize GetImageSize() const noexcept;
+
+    std::vector<MemoryAllocation> m_imageMemory;
+    bool m_readbackEnabled;
+    std::vector<AllocatedBuffer> m_readbackBuffers;
+    uint32_t m_nextImage;
+    int64_t m_lastImage;
+    uint64_t m_frameCount;
+};
@@ -0,0 +1,1503 @@
+#include "VulkanRenderer.h"
+#include "VulkanException.h"
+#include <algorithm>
+#include <sstream>
+#include <chrono>
+#include <limits>
+#include <cstring>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <dlfcn.h>
+#endif
+
+#ifdef _WIN32
+#pragma comment(lib, "vulkan-1.lib")
+#endif
+
+const std::vector<const char*> validationLayers = {
+    "VK_LAYER_LUNARG_standard_validation"
+};
+
+const std::vector<Vertex> triangleVertices = {
+    { { 0.0f, -0.5f }, { 1.0f, 0.0f, 0.0f } },
+    { { 0.5f, 0.5f }, { 0.0f, 1.0f, 0.0f } },
+    { { -0.5f, 0.5f }, { 0.0f, 0.0f, 1.0f } }
+};
+
+const std::vector<uint32_t> triangleIndices = { 0, 1, 2 };
+
+// a single instance that leaves the triangle as it is
+const std::vector<InstanceData> defaultInstances = {
+    { { 0.0f, 0.0f }, 1.0f, 0.0f, { 1.0f, 1.0f, 1.0f, 1.0f } }
+};
+
+#ifdef _DEBUG
+const bool enableValidationLayers = true;
+#else
+const bool enableValidationLayers = false;
+#endif
+
+static const float identityTransform[16] = {
+    1.0f, 0.0f, 0.0f, 0.0f,
+    0.0f, 1.0f, 0.0f, 0.0f,
+    0.0f, 0.0f, 1.0f, 0.0f,
+    0.0f, 0.0f, 0.0f, 1.0f
+};
+
+VulkanRenderer::VulkanRenderer(std::shared_ptr<VulkanContext> context)
+    : m_context(context ? context : std::make_shared<VulkanContext>()),
+    m_vulkanInitialized(false), m_instance(VK_NULL_HANDLE),
+    m_surface(VK_NULL_HANDLE), m_physicalDevice(VK_NULL_HANDLE),
+    m_logicalDevice(VK_NULL_HANDLE), m_graphicsQueue(VK_NULL_HANDLE),
+    m_presentQueue(VK_NULL_HANDLE), m_transferQueue(VK_NULL_HANDLE), m_imageFormat(VK_FORMAT_UNDEFINED),
+    m_extent({ 0, 0 }), m_finalLayout(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR),
+    m_renderPass(VK_NULL_HANDLE), m_pipelineLayout(VK_NULL_HANDLE),
+    m_graphicsPipeline(VK_NULL_HANDLE),
+    m_indexCount(0), m_instanceCount(0), m_instancesPerDraw(0), m_sceneVersion(1), m_reuseCommandBuffers(true),
+    m_rotationSpeed(0.0f), m_startTime(std::chrono::steady_clock::now()),
+    m_descriptorSetLayout(VK_NULL_HANDLE),
+    m_descriptorPool(VK_NULL_HANDLE), m_frameDescriptorSet(VK_NULL_HANDLE),
+    m_frames(DEFAULT_FRAMES_IN_FLIGHT), m_currentFrame(0)
+{
+    std::memcpy(m_viewTransform, identityTransform, sizeof(identityTransform));
+    m_deletionQueue.Create(*m_context);
+}
+
+VulkanRenderer::~VulkanRenderer() noexcept
+{
+    // the context destroys the device and instance once no renderer is using them
+    if (m_logicalDevice != VK_NULL_HANDLE) {
+        // only this renderer's frames can be using what it destroys; other renderers may share the device
+        m_context->Wait(GetFramesInFlight());
+        m_deletionQueue.Flush();
+        m_stagingUploader.Destroy();
+        DestroyGraphicsPipeline();
+        DestroyFrameBuffers();
+        DestroyImageViews();
+        DestroyRenderPass();
+        DestroyFrameResources();
+        m_frameProfiler.Destroy();
+        m_parallelRecorder.Destroy();
+        DestroyDescriptors();
+        m_frameArena.Destroy();
+        DestroyMeshBuffers();
+    }
+}
+
+void VulkanRenderer::RunInitSteps(InitScheduler& scheduler)
+{
+    scheduler.Run();
+    const auto& timings = scheduler.GetTimings();
+    m_initTimings.insert(m_initTimings.end(), timings.begin(), timings.end());
+}
+
+void VulkanRenderer::InitializeInstance(const std::string& appName, const std::vector<const char*>& requiredExtensions)
+{
+    InitializeVulkan(requiredExtensions);
+    VkApplicationInfo appInfo = CreateApplicationInfo(appName, VK_MAKE_VERSION(1, 0, 0), "No Engine",
+        VK_MAKE_VERSION(1, 0, 0), m_context->ChooseApiVersion());
+    std::vector<const char*> layerNames;
+    if (enableValidationLayers) {
+        layerNames = validationLayers;
+    }
+    VkInstanceCreateInfo createInfo = CreateInstanceCreateInfo(appInfo, requiredExtensions, layerNames);
+    CreateInstance(createInfo);
+}
+
+void VulkanRenderer::InitializeVulkan(std::vector<const char*> requiredExtensions)
+{
+    // make sure that the Vulkan library is available on this system
+#ifdef _WIN32
+    HMODULE vulkanModule = ::LoadLibraryA("vulkan-1.dll");
+    if (vulkanModule == NULL) {
+        throw std::runtime_error("Vulkan library is not available on this system, so program cannot run.\n"
+            "You must install the appropriate Vulkan library and also have a graphics card that supports Vulkan.");
+    }
+#elif defined(__linux__)
+    void* vulkanModule = dlopen("libvulkan.so.1", RTLD_NOW | RTLD_LOCAL);
+    if (vulkanModule == nullptr) {
+        throw std::runtime_error("Vulkan library is not available on this system, so program cannot run.\n"
+            "You must install the appropriate Vulkan loader and either a Vulkan capable GPU driver or a "
+            "software implementation such as lavapipe.");
+    }
+    // the program links against the loader, so the probe's reference is not needed
+    dlclose(vulkanModule);
+#else
+#error Only Win32 and Linux are currently supported. To see how to support other windowing systems, \
+ see the definition of _glfw_dlopen in XXX_platform.h and its use in vulkan.c in the glfw\
+ source code. XXX specifies the windowing system (e.g. x11 for X11, and wl for Wayland).
+#endif
+    // make sure that the correct extensions are available
+    uint32_t count;
+    VkResult err = vkEnumerateInstanceExtensionProperties(nullptr, &count, nullptr);
+    if (err != VK_SUCCESS) {
+        throw VulkanException(err, "Failed to retrieve the instance extension properties:");
+    }
+    std::vector<VkExtensionProperties> extensions(count);
+    err = vkEnumerateInstanceExtensionProperties(nullptr, &count, extensions.data());
+    if (err != VK_SUCCESS) {
+        throw VulkanException(err, "Failed to retrieve the instance extension properties:");
+    }
+    for(int extNum = 0; extNum < extensions.size(); ++extNum) {
+        for (auto iter = requiredExtensions.begin(); iter < requiredExtensions.end(); ++iter) {
+            if (std::string(*iter) == extensions[extNum].extensionName) {
+                requiredExtensions.erase(iter);
+                break;
+            }
+        }
+    };
+    if (!requiredExtensions.empty()) {
+        std::stringstream ss;
+        ss << "The following required Vulkan extensions could not be found:\n";
+        for (int extNum = 0; extNum < requiredExtensions.size(); ++extNum) {
+            ss << requiredExtensions[extNum] << "\n";
+        }
+        ss << "Program cannot continue.";
+        throw std::runtime_error(ss.str());
+    }
+
+    m_vulkanInitialized = true;
+}
+
+VkApplicationInfo VulkanRenderer::CreateApplicationInfo(const std::string& appName,
+    const int32_t appVersion,
+    const std::string& engineName,
+    const int32_t engineVersion,
+    const int32_t apiVersion) const noexcept
+{
+    VkApplicationInfo appInfo = {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = appName.c_str();
+    appInfo.applicationVersion = appVersion;
+    appInfo.pEngineName = engineName.c_str();
+    appInfo.engineVersion = engineVersion;
+    appInfo.apiVersion = apiVersion;
+    return appInfo;
+}
+
+VkInstanceCreateInfo VulkanRenderer::CreateInstanceCreateInfo(const VkApplicationInfo& appInfo,
+    const std::vector<const char*>& extensionNames,
+    const std::vector<const char*>& layerNames) const noexcept
+{
+    VkInstanceCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    createInfo.pApplicationInfo = &appInfo;
+    createInfo.enabledExtensionCount = extensionNames.size();
+    createInfo.ppEnabledExtensionNames = extensionNames.data();
+    createInfo.enabledLayerCount = layerNames.size();
+    createInfo.ppEnabledLayerNames = layerNames.data();
+    return createInfo;
+}
+
+void VulkanRenderer::CreateInstance(const VkInstanceCreateInfo& createInfo)
+{
+    if (!m_vulkanInitialized) {
+        throw std::runtime_error("Programming Error:\nAttempted to create a Vulkan instance before Vulkan was initialized.");
+    }
+    m_context->CreateInstance(createInfo);
+    m_instance = m_context->GetInstance();
+}
+
+void VulkanRenderer::PickPhysicalDevice()
+{
+    if (!m_instance) {
+        throw std::runtime_error("Programming Error:\n"
+            "Attempted to get a Vulkan physical device before the Vulkan instance was created.");
+    }
+    const DeviceSelector& selector = m_context->GetDeviceSelector();
+    if (selector.GetDevices().empty()) {
+        throw std::runtime_error("Failed to find a GPU with Vulkan support.");
+    }
+    m_physicalDevice = selector.Select([this](const PhysicalDeviceInfo& info) { return IsDeviceSuitable(info.device); },
+        m_context->GetDeviceOverride());
+    if (m_physicalDevice == VK_NULL_HANDLE) {
+        throw std::runtime_error("No physical GPU could be found with the required extensions and swap chain support.");
+    }
+    m_context->SetPhysicalDevice(m_physicalDevice);
+}
+
+bool VulkanRenderer::IsDeviceSuitable(const VkPhysicalDevice& device) const
+{
+    QueueFamilyIndices indices = FindQueueFamilies(device);
+    bool extensionsSupported = CheckDeviceExtensionSupport(device);
+    return indices.IsComplete() && extensionsSupported;
+}
+
+QueueFamilyIndices VulkanRenderer::FindQueueFamilies(const VkPhysicalDevice& device) const
+{
+    QueueFamilyIndices indices;
+    const std::vector<VkQueueFamilyProperties>& queueFamilies =
+        m_context->GetDeviceSelector().GetInfo(device).queueFamilies;
+
+    int i = 0;
+    for (const auto& queueFamily : queueFamilies) {
+        if (queueFamily.queueCount > 0 && queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+            indices.graphicsFamily = i;
+        }
+        VkBool32 presentSupport = false;
+        if (m_surface != VK_NULL_HANDLE) {
+            VkResult result = vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+            if (result != VK_SUCCESS) {
+                throw VulkanException(result, "Error while attempting to check if a surface supports presentation:");
+            }
+        }
+        else {
+            // nothing is presented when rendering offscreen, so the graphics queue stands in
+            presentSupport = indices.graphicsFamily == i;
+        }
+        if (queueFamily.queueCount > 0 && presentSupport) {
+            indices.presentFamily = i;
+        }
+        if (indices.IsComplete()) {
+            break;
+        }
+        ++i;
+    }
+
+    // a transfer-only family is usually backed by a DMA engine, so prefer one without compute as well
+    int bestTransferScore = 0;
+    for (int family = 0; family < static_cast<int>(queueFamilies.size()); ++family) {
+        VkQueueFlags flags = queueFamilies[family].queueFlags;
+        if (queueFamilies[family].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) ||
+            flags & VK_QUEUE_GRAPHICS_BIT) {
+            continue;
+        }
+        int score = flags & VK_QUEUE_COMPUTE_BIT ? 1 : 2;
+        if (score > bestTransferScore) {
+            bestTransferScore = score;
+            indices.transferFamily = family;
+        }
+    }
+    if (indices.transferFamily < 0) {
+        // graphics queues always support transfers
+        indices.transferFamily = indices.graphicsFamily;
+    }
+    return indices;
+}
+
+bool VulkanRenderer::CheckDeviceExtensionSupport(const VkPhysicalDevice& device) const
+{
+    const std::set<std::string>& availableExtensions = m_context->GetDeviceSelector().GetInfo(device).extensions;
+    for (const char* extension : m_deviceExtensions) {
+        if (availableExtensions.count(extension) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VkDeviceQueueCreateInfo VulkanRenderer::CreateDeviceQueueCreateInfo(int queueFamily) const noexcept
+{
+    static const float queuePriority = 1.0f;
+    VkDeviceQueueCreateInfo queueCreateInfo = {};
+    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfo.queueFamilyIndex = queueFamily;
+    queueCreateInfo.queueCount = 1;
+    queueCreateInfo.pQueuePriorities = &queuePriority;
+    return queueCreateInfo;
+}
+
+std::vector<VkDeviceQueueCreateInfo> VulkanRenderer::CreateQueueCreateInfos(
+    const std::set<int>& uniqueQueueFamilies) const noexcept
+{
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+
+    for (int queueFamily : uniqueQueueFamilies) {
+        VkDeviceQueueCreateInfo queueCreateInfo = CreateDeviceQueueCreateInfo(queueFamily);
+        queueCreateInfos.push_back(queueCreateInfo);
+    }
+    return queueCreateInfos;
+}
+
+VkDeviceCreateInfo VulkanRenderer::CreateDeviceCreateInfo(
+    const std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos,
+    const VkPhysicalDeviceFeatures& deviceFeatures) const noexcept
+{
+    VkDeviceCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pQueueCreateInfos = queueCreateInfos.data();
+    createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
+    createInfo.pEnabledFeatures = &deviceFeatures;
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(m_deviceExtensions.size());
+    createInfo.ppEnabledExtensionNames = m_deviceExtensions.data();
+    if (enableValidationLayers) {
+        createInfo.enabledLayerCount = validationLayers.size();
+        createInfo.ppEnabledLayerNames = validationLayers.data();
+    }
+    else {
+        createInfo.enabledLayerCount = 0;
+    }
+    return createInfo;
+}
+
+void VulkanRenderer::CreateLogicalDevice()
+{
+    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+    std::set<int> uniqueQueueFamilies = { indices.graphicsFamily, indices.presentFamily, indices.transferFamily };
+    std::vector<VkDeviceQueueCreateInfo> queueCreateInfos = CreateQueueCreateInfos(uniqueQueueFamilies);
+    VkPhysicalDeviceFeatures deviceFeatures = {};
+    VkDeviceCreateInfo createInfo = CreateDeviceCreateInfo(queueCreateInfos, deviceFeatures);
+
+    m_context->CreateLogicalDevice(createInfo, uniqueQueueFamilies);
+    m_logicalDevice = m_context->GetDevice();
+    m_graphicsQueue = m_context->GetQueue(indices.graphicsFamily);
+    m_presentQueue = m_context->GetQueue(indices.presentFamily);
+    m_transferQueue = m_context->GetQueue(indices.transferFamily);
+}
+
+void VulkanRenderer::AttachContext(const std::vector<const char*>& instanceExtensions)
+{
+    if (!m_context->IsDeviceCreated()) {
+        throw std::runtime_error("Programming Error:\nAttempted to attach to a Vulkan context that has no device.");
+    }
+    if (!m_context->HasInstanceExtensions(instanceExtensions) || !m_context->HasDeviceExtensions(m_deviceExtensions)) {
+        throw std::runtime_error("Programming Error:\n"
+            "The shared Vulkan context was created without extensions that this renderer needs.");
+    }
+    m_vulkanInitialized = true;
+    m_instance = m_context->GetInstance();
+    m_physicalDevice = m_context->GetPhysicalDevice();
+    m_logicalDevice = m_context->GetDevice();
+    // there is no surface yet, so the graphics queue stands in for presentation
+    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+    m_graphicsQueue = m_context->GetQueue(indices.graphicsFamily);
+    m_presentQueue = m_graphicsQueue;
+    m_transferQueue = m_context->GetQueue(indices.transferFamily);
+}
+
+void VulkanRenderer::SelectPresentQueue()
+{
+    // the device was chosen for another renderer's surface, so it may not suit this one
+    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+    if (IsDeviceSuitable(m_physicalDevice)) {
+        m_presentQueue = m_context->GetQueue(indices.presentFamily);
+    }
+    else {
+        m_presentQueue = VK_NULL_HANDLE;
+    }
+    if (m_presentQueue == VK_NULL_HANDLE) {
+        throw std::runtime_error("The shared Vulkan device cannot present to this window.");
+    }
+}
+
+VkImageViewCreateInfo VulkanRenderer::CreateImageViewCreateInfo(uint32_t imageIndex) const noexcept
+{
+    VkImageViewCreateInfo createInfo = {};
+    createInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    createInfo.image = m_images[imageIndex];
+    createInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    createInfo.format = m_imageFormat;
+    createInfo.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+    createInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    createInfo.subresourceRange.baseMipLevel = 0;
+    createInfo.subresourceRange.levelCount = 1;
+    createInfo.subresourceRange.baseArrayLayer = 0;
+    createInfo.subresourceRange.layerCount = 1;
+    return createInfo;
+}
+
+void VulkanRenderer::CreateImageViews()
+{
+    m_imageViews.resize(m_images.size());
+    for (uint32_t i = 0; i < m_images.size(); i++) {
+        VkImageViewCreateInfo createInfo = CreateImageViewCreateInfo(i);
+
+        VkResult result = vkCreateImageView(m_logicalDevice, &createInfo, nullptr, &m_imageViews[i]);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Unable to create an image view for a swap chain image");
+        }
+    }
+}
+
+VkAttachmentDescription VulkanRenderer::CreateAttachmentDescription() const noexcept
+{
+    VkAttachmentDescription colorAttachment = {};
+    colorAttachment.format = m_imageFormat;
+    colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    colorAttachment.finalLayout = m_finalLayout;
+    return colorAttachment;
+}
+
+VkAttachmentReference VulkanRenderer::CreateAttachmentReference() const noexcept
+{
+    VkAttachmentReference colorAttachmentRef = {};
+    colorAttachmentRef.attachment = 0;
+    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    return colorAttachmentRef;
+}
+
+VkSubpassDescription VulkanRenderer::CreateSubpassDescription(
+    const VkAttachmentReference& attachmentRef) const noexcept
+{
+    VkSubpassDescription subPass = {};
+    subPass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subPass.colorAttachmentCount = 1;
+    subPass.pColorAttachments = &attachmentRef;
+    return subPass;
+}
+
+VkSubpassDependency VulkanRenderer::CreateSubpassDependency() const noexcept
+{
+    VkSubpassDependency dependency = {};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    dependency.srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    return dependency;
+}
+
+VkRenderPassCreateInfo VulkanRenderer::CreateRenderPassCreateInfo(
+    const VkAttachmentDescription& colorAttachment,
+    const VkSubpassDescription& subPass,
+    const VkSubpassDependency& dependency) const noexcept
+{
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &colorAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subPass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+    return renderPassInfo;
+}
+
+void VulkanRenderer::CreateRenderPass() 
+{
+    // with dynamic rendering the attachments are named when recording begins
+    if (m_context->UsesDynamicRendering()) {
+        return;
+    }
+    VkAttachmentDescription colorAttachment = CreateAttachmentDescription();
+    VkAttachmentReference colorAttachmentRef = CreateAttachmentReference();
+    VkSubpassDescription subPass = CreateSubpassDescription(colorAttachmentRef);
+    VkSubpassDependency dependency = CreateSubpassDependency();
+    VkRenderPassCreateInfo renderPassInfo = CreateRenderPassCreateInfo(colorAttachment,
+        subPass, dependency);
+
+    VkResult result = vkCreateRenderPass(m_logicalDevice, &renderPassInfo, nullptr, &m_renderPass);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to create a render pass:");
+    }
+}
+
+VkPipelineShaderStageCreateInfo VulkanRenderer::CreatePipelineShaderStageCreateInfo(
+    VkShaderStageFlagBits stage, VkShaderModule& module, const char* entryName,
+    const VkSpecializationInfo* specializationInfo) const noexcept
+{
+    VkPipelineShaderStageCreateInfo shaderStageInfo = {};
+    shaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStageInfo.stage = stage;
+    shaderStageInfo.module = module;
+    shaderStageInfo.pName = entryName;
+    shaderStageInfo.pSpecializationInfo = specializationInfo;
+    return shaderStageInfo;
+}
+
+VkPipelineVertexInputStateCreateInfo VulkanRenderer::CreatePipelineVertexInputStateCreateInfo(
+    const std::array<VkVertexInputBindingDescription, 2>& bindingDescriptions,
+    const std::array<VkVertexInputAttributeDescription, 4>& attributeDescriptions) const noexcept
+{
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = {};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount = static_cast<uint32_t>(bindingDescriptions.size());
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
+    return vertexInputInfo;
+}
+
+VkViewport VulkanRenderer::CreateViewport() const noexcept
+{
+    VkViewport viewport = {};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = (float)m_extent.width;
+    viewport.height = (float)m_extent.height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    return viewport;
+}
+
+VkRect2D VulkanRenderer::CreateScissor() const noexcept
+{
+    VkRect2D scissor = {};
+    scissor.offset = { 0, 0 };
+    scissor.extent = m_extent;
+    return scissor;
+}
+
+VkPipelineViewportStateCreateInfo VulkanRenderer::CreatePipelineViewportStateCreateInfo() const noexcept
+{
+    // the viewport and scissor themselves are dynamic state, set when the command buffer is recorded
+    VkPipelineViewportStateCreateInfo viewportState = {};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    return viewportState;
+}
+
+VkPipelineDynamicStateCreateInfo VulkanRenderer::CreatePipelineDynamicStateCreateInfo() const noexcept
+{
+    static const VkDynamicState dynamicStates[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = sizeof(dynamicStates) / sizeof(dynamicStates[0]);
+    dynamicState.pDynamicStates = dynamicStates;
+    return dynamicState;
+}
+
+VkPipelineMultisampleStateCreateInfo VulkanRenderer::CreatePipelineMultisampleStateCreateInfo() const noexcept
+{
+    VkPipelineMultisampleStateCreateInfo multisampling = {};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    return multisampling;
+}
+
+VkPipelineColorBlendStateCreateInfo VulkanRenderer::CreatePipelineColorBlendStateCreateInfo(
+    const VkPipelineColorBlendAttachmentState& colorBlendAttachment) const noexcept
+{
+    VkPipelineColorBlendStateCreateInfo colorBlending = {};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+    colorBlending.blendConstants[0] = 0.0f;
+    colorBlending.blendConstants[1] = 0.0f;
+    colorBlending.blendConstants[2] = 0.0f;
+    colorBlending.blendConstants[3] = 0.0f;
+    return colorBlending;
+}
+
+VkPushConstantRange VulkanRenderer::CreatePushConstantRange() const noexcept
+{
+    VkPushConstantRange pushConstantRange = {};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(DrawConstants);
+    return pushConstantRange;
+}
+
+VkDescriptorSetLayoutBinding VulkanRenderer::CreateDescriptorSetLayoutBinding() const noexcept
+{
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    // dynamic, so that each frame's uniforms are selected by an offset into the frame arena
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    binding.descriptorCount = 1;
+    binding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    return binding;
+}
+
+VkDescriptorSetLayoutCreateInfo VulkanRenderer::CreateDescriptorSetLayoutCreateInfo(
+    const VkDescriptorSetLayoutBinding& binding) const noexcept
+{
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+    return layoutInfo;
+}
+
+VkDescriptorPoolCreateInfo VulkanRenderer::CreateDescriptorPoolCreateInfo(
+    const VkDescriptorPoolSize& poolSize) const noexcept
+{
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = 1;
+    return poolInfo;
+}
+
+VkDescriptorSetAllocateInfo VulkanRenderer::CreateDescriptorSetAllocateInfo() const noexcept
+{
+    VkDescriptorSetAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+    return allocInfo;
+}
+
+// Also gets the pipeline layout. The context creates both for its first renderer.
+void VulkanRenderer::CreateDescriptorSetLayout()
+{
+    VkDescriptorSetLayoutBinding binding = CreateDescriptorSetLayoutBinding();
+    VkDescriptorSetLayoutCreateInfo layoutInfo = CreateDescriptorSetLayoutCreateInfo(binding);
+    m_context->CreatePipelineLayout(layoutInfo, CreatePushConstantRange());
+    m_descriptorSetLayout = m_context->GetDescriptorSetLayout();
+    m_pipelineLayout = m_context->GetPipelineLayout();
+}
+
+void VulkanRenderer::CreateDescriptorSets()
+{
+    if (m_descriptorPool == VK_NULL_HANDLE) {
+        VkDescriptorPoolSize poolSize = { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 };
+        VkDescriptorPoolCreateInfo poolInfo = CreateDescriptorPoolCreateInfo(poolSize);
+        VkResult result = vkCreateDescriptorPool(m_logicalDevice, &poolInfo, nullptr, &m_descriptorPool);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create the descriptor pool:");
+        }
+        VkDescriptorSetAllocateInfo allocInfo = CreateDescriptorSetAllocateInfo();
+        result = vkAllocateDescriptorSets(m_logicalDevice, &allocInfo, &m_frameDescriptorSet);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to allocate the frame descriptor set:");
+        }
+    }
+    // called again whenever the frame arena, and so its buffer, is recreated
+    VkDescriptorBufferInfo bufferInfo = {};
+    bufferInfo.buffer = m_frameArena.GetBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(FrameUniforms);
+
+    VkWriteDescriptorSet descriptorWrite = {};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = m_frameDescriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+    vkUpdateDescriptorSets(m_logicalDevice, 1, &descriptorWrite, 0, nullptr);
+}
+
+void VulkanRenderer::DestroyDescriptors() noexcept
+{
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(m_logicalDevice, m_descriptorPool, nullptr);
+        m_descriptorPool = VK_NULL_HANDLE;
+        m_frameDescriptorSet = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanRenderer::CreateMemoryAllocator()
+{
+    m_context->CreateMemoryAllocator();
+}
+
+void VulkanRenderer::CreateStagingUploader()
+{
+    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+    m_stagingUploader.Create(*m_context, m_transferQueue, static_cast<uint32_t>(indices.transferFamily),
+        static_cast<uint32_t>(indices.graphicsFamily));
+}
+
+void VulkanRenderer::CreateMeshBuffers()
+{
+    SetMesh(triangleVertices, triangleIndices);
+    SetInstances(defaultInstances);
+}
+
+void VulkanRenderer::DestroyMeshBuffers() noexcept
+{
+    m_context->GetMemoryAllocator().DestroyBuffer(m_vertexBuffer);
+    m_context->GetMemoryAllocator().DestroyBuffer(m_indexBuffer);
+    m_context->GetMemoryAllocator().DestroyBuffer(m_instanceBuffer);
+    m_indexCount = 0;
+    m_instanceCount = 0;
+}
+
+void VulkanRenderer::ReplaceDeviceBuffer(AllocatedBuffer& buffer, const void* data, VkDeviceSize size,
+    VkBufferUsageFlags usage, VkAccessFlags dstAccess)
+{
+    // copies into the old buffer may still be pending, and the frames in flight may still read it
+    if (buffer.buffer != VK_NULL_HANDLE) {
+        std::vector<SubmitPoint> points = GetFramesInFlight();
+        std::vector<SubmitPoint> copies = m_stagingUploader.Discard(buffer.buffer);
+        points.insert(points.end(), copies.begin(), copies.end());
+        DeviceMemoryAllocator* allocator = &m_context->GetMemoryAllocator();
+        AllocatedBuffer retired = buffer;
+        m_deletionQueue.Retire(points, [allocator, retired]() mutable {
+            allocator->DestroyBuffer(retired);
+        });
+    }
+    buffer = m_context->GetMemoryAllocator().CreateBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    m_stagingUploader.Upload(buffer.buffer, 0, data, size, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, dstAccess);
+}
+
+void VulkanRenderer::SetMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices)
+{
+    if (vertices.empty() || indices.empty()) {
+        throw std::runtime_error("Programming Error:\nSetMesh called with no vertices or no indices.");
+    }
+    ReplaceDeviceBuffer(m_vertexBuffer, vertices.data(), sizeof(Vertex) * vertices.size(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    ReplaceDeviceBuffer(m_indexBuffer, indices.data(), sizeof(uint32_t) * indices.size(),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_ACCESS_INDEX_READ_BIT);
+    // start the copies now rather than when the next frame is recorded
+    m_stagingUploader.Flush();
+    m_indexCount = static_cast<uint32_t>(indices.size());
+    MarkSceneDirty();
+}
+
+void VulkanRenderer::SetInstances(const std::vector<InstanceData>& instances)
+{
+    if (instances.empty()) {
+        throw std::runtime_error("Programming Error:\nSetInstances called with no instances.");
+    }
+    ReplaceDeviceBuffer(m_instanceBuffer, instances.data(), sizeof(InstanceData) * instances.size(),
+        VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+    m_stagingUploader.Flush();
+    m_instanceCount = static_cast<uint32_t>(instances.size());
+    MarkSceneDirty();
+}
+
+void VulkanRenderer::CreateFrameArena()
+{
+    const VkPhysicalDeviceProperties& properties = m_context->GetDeviceSelector().GetInfo(m_physicalDevice).properties;
+    m_frameArena.Create(m_context->GetMemoryAllocator(), static_cast<uint32_t>(m_frames.size()),
+        FrameArena::DEFAULT_BYTES_PER_FRAME, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+        properties.limits.minUniformBufferOffsetAlignment);
+}
+
+void VulkanRenderer::SetViewTransform(const float transform[16]) noexcept
+{
+    std::memcpy(m_viewTransform, transform, sizeof(m_viewTransform));
+}
+
+void VulkanRenderer::WriteFrameUniforms(FrameUniforms& uniforms) const noexcept
+{
+    std::memcpy(uniforms.transform, m_viewTransform, sizeof(m_viewTransform));
+    uniforms.seconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - m_startTime).count();
+    uniforms.rotationSpeed = m_rotationSpeed;
+}
+
+// every draw gets the same tint here, so the draw index is only named by overrides
+void VulkanRenderer::WriteDrawConstants(uint32_t, DrawConstants& constants) const noexcept
+{
+    constants.tint[0] = 1.0f;
+    constants.tint[1] = 1.0f;
+    constants.tint[2] = 1.0f;
+    constants.tint[3] = 1.0f;
+}
+
+VkGraphicsPipelineCreateInfo VulkanRenderer::CreateGraphicsPipelineCreateInfo(
+    const VkPipelineShaderStageCreateInfo shaderStages[],
+    const VkPipelineVertexInputStateCreateInfo& vertexInputInfo,
+    const VkPipelineInputAssemblyStateCreateInfo& inputAssembly,
+    const VkPipelineViewportStateCreateInfo& viewportState,
+    const VkPipelineRasterizationStateCreateInfo& rasterizer,
+    const VkPipelineMultisampleStateCreateInfo& multisampling,
+    const VkPipelineColorBlendStateCreateInfo& colorBlending,
+    const VkPipelineDynamicStateCreateInfo& dynamicState,
+    VkPipelineLayout layout, VkRenderPass renderPass) const noexcept
+{
+    VkGraphicsPipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = layout;
+    pipelineInfo.renderPass = renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+    return pipelineInfo;
+}
+
+VkPipelineRenderingCreateInfo VulkanRenderer::CreatePipelineRenderingCreateInfo(
+    const VkFormat& colorFormat) const noexcept
+{
+    VkPipelineRenderingCreateInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    return renderingInfo;
+}
+
+void VulkanRenderer::CreateGraphicsPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile)
+{
+    PipelineKey key;
+    key.vertexShader = m_context->GetShaderModule(vertexShaderFile);
+    key.fragmentShader = m_context->GetShaderModule(fragmentShaderFile);
+    key.layout = m_pipelineLayout;
+    key.colorFormat = m_imageFormat;
+    key.state = m_pipelineState;
+    m_graphicsPipeline = m_context->GetPipelineRegistry().GetOrCompile(key, CreatePipelineCompile(key));
+    m_pipelineKey = key;
+}
+
+// The compile captures the current render pass, so DestroyGraphicsPipeline waits for it before the
+// render pass is replaced.
+PipelineRegistry::Compile VulkanRenderer::CreatePipelineCompile(const PipelineKey& key) const
+{
+    VkRenderPass renderPass = m_renderPass;
+    return [this, key, renderPass] { return CompileGraphicsPipeline(key, renderPass); };
+}
+
+// Runs on the registry's worker threads, so it only reads what does not change while the renderer
+// is drawing.
+VkPipeline VulkanRenderer::CompileGraphicsPipeline(const PipelineKey& key, VkRenderPass renderPass) const
+{
+    VkShaderModule vertShaderModule = key.vertexShader;
+    VkShaderModule fragShaderModule = key.fragmentShader;
+    // the fragment shader variant is chosen by specialization constants rather than by module
+    std::array<VkSpecializationMapEntry, 2> fragmentEntries = FragmentVariant::GetMapEntries();
+    VkSpecializationInfo fragmentSpecialization = key.state.fragment.GetSpecializationInfo(fragmentEntries);
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo = CreatePipelineShaderStageCreateInfo(
+        VK_SHADER_STAGE_VERTEX_BIT, vertShaderModule, "main");
+    VkPipelineShaderStageCreateInfo fragShaderStageInfo = CreatePipelineShaderStageCreateInfo(
+        VK_SHADER_STAGE_FRAGMENT_BIT, fragShaderModule, "main", &fragmentSpecialization);
+    VkPipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo, fragShaderStageInfo };
+    
+    std::array<VkVertexInputBindingDescription, 2> bindingDescriptions = {
+        Vertex::GetBindingDescription(), InstanceData::GetBindingDescription() };
+    std::array<VkVertexInputAttributeDescription, 2> vertexAttributes = Vertex::GetAttributeDescriptions();
+    std::array<VkVertexInputAttributeDescription, 2> instanceAttributes = InstanceData::GetAttributeDescriptions();
+    std::array<VkVertexInputAttributeDescription, 4> attributeDescriptions = {
+        vertexAttributes[0], vertexAttributes[1], instanceAttributes[0], instanceAttributes[1] };
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo = CreatePipelineVertexInputStateCreateInfo(
+        bindingDescriptions, attributeDescriptions);
+    // the presets are constexpr, so these are copies of state built at compile time
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly = key.state.topology.GetInputAssemblyState();
+    VkPipelineViewportStateCreateInfo viewportState = CreatePipelineViewportStateCreateInfo();
+    VkPipelineDynamicStateCreateInfo dynamicState = CreatePipelineDynamicStateCreateInfo();
+    VkPipelineRasterizationStateCreateInfo rasterizer = key.state.raster.GetRasterizationState();
+    VkPipelineMultisampleStateCreateInfo multisampling = CreatePipelineMultisampleStateCreateInfo();
+    VkPipelineColorBlendAttachmentState colorBlendAttachment = key.state.blend.GetAttachmentState();
+    VkPipelineColorBlendStateCreateInfo colorBlending = CreatePipelineColorBlendStateCreateInfo(
+        colorBlendAttachment);
+
+    VkGraphicsPipelineCreateInfo pipelineInfo = CreateGraphicsPipelineCreateInfo(shaderStages,
+        vertexInputInfo, inputAssembly, viewportState, rasterizer, multisampling, colorBlending,
+        dynamicState, key.layout, renderPass);
+    // without a render pass, the pipeline only depends on the attachment formats
+    VkPipelineRenderingCreateInfo renderingInfo = CreatePipelineRenderingCreateInfo(key.colorFormat);
+    if (m_context->UsesDynamicRendering()) {
+        pipelineInfo.pNext = &renderingInfo;
+    }
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = vkCreateGraphicsPipelines(m_logicalDevice, m_context->GetPipelineCache().GetHandle(), 1,
+        &pipelineInfo, nullptr, &pipeline);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to create graphics pipeline:");
+    }
+    return pipeline;
+}
+
+// Switches to the pipeline for m_pipelineState once the registry has compiled it; until then the
+// previous pipeline stands in for it.
+void VulkanRenderer::UpdateGraphicsPipeline()
+{
+    if (m_pipelineKey.state == m_pipelineState) {
+        return;
+    }
+    PipelineKey key = m_pipelineKey;
+    key.state = m_pipelineState;
+    VkPipeline pipeline = m_context->GetPipelineRegistry().Request(key, CreatePipelineCompile(key));
+    if (pipeline != VK_NULL_HANDLE) {
+        m_graphicsPipeline = pipeline;
+        m_pipelineKey = key;
+        // command buffers recorded with the stand-in
+        MarkSceneDirty();
+    }
+}
+
+void VulkanRenderer::SetPipelineState(const PipelineState& state)
+{
+    m_pipelineState = state;
+    // start compiling now rather than when the next frame is recorded
+    if (m_graphicsPipeline != VK_NULL_HANDLE) {
+        UpdateGraphicsPipeline();
+    }
+}
+
+void VulkanRenderer::LoadShaders(const std::vector<std::string>& names)
+{
+    m_context->LoadShaders(names);
+}
+
+VkFramebufferCreateInfo VulkanRenderer::CreateFramebufferCreateInfo(
+    const VkImageView& attachments) const noexcept
+{
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = m_renderPass;
+    framebufferInfo.attachmentCount = 1;
+    framebufferInfo.pAttachments = &attachments;
+    framebufferInfo.width = m_extent.width;
+    framebufferInfo.height = m_extent.height;
+    framebufferInfo.layers = 1;
+    return framebufferInfo;
+}
+
+void VulkanRenderer::CreateFrameBuffers()
+{
+    if (m_context->UsesDynamicRendering()) {
+        // the image views are named when recording begins, and may also reuse old handles
+        MarkSceneDirty();
+        return;
+    }
+    m_framebuffers.resize(m_imageViews.size(), VK_NULL_HANDLE);
+
+    for (size_t i = 0; i < m_imageViews.size(); i++) {
+        VkImageView attachments[] = {
+            m_imageViews[i]
+        };
+
+        VkFramebufferCreateInfo framebufferInfo = CreateFramebufferCreateInfo(*attachments);
+
+        VkResult result = vkCreateFramebuffer(m_logicalDevice, &framebufferInfo, nullptr, &m_framebuffers[i]);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create framebuffer:");
+        }
+    }
+    // a new framebuffer may reuse an old handle, so recorded command buffers cannot be trusted
+    MarkSceneDirty();
+}
+
+VkCommandPoolCreateInfo VulkanRenderer::CreateCommandPoolCreateInfo(
+    QueueFamilyIndices& queueFamilyIndices) const noexcept
+{
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    // the pool is reset as a whole whenever its frame's command buffer is re-recorded
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily;
+    return poolInfo;
+}
+
+VkCommandBufferAllocateInfo VulkanRenderer::CreateCommandBufferAllocateInfo(VkCommandPool commandPool) const noexcept
+{
+    VkCommandBufferAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.commandPool = commandPool;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    return allocInfo;
+}
+
+VkCommandBufferBeginInfo VulkanRenderer::CreateCommandBufferBeginInfo() const noexcept
+{
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    // not one-time-submit: an unchanged command buffer is submitted again on later frames
+    beginInfo.flags = 0;
+    return beginInfo;
+}
+
+VkCommandBufferInheritanceInfo VulkanRenderer::CreateCommandBufferInheritanceInfo(size_t imageIndex,
+    const VkCommandBufferInheritanceRenderingInfo& renderingInfo) const noexcept
+{
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    if (m_context->UsesDynamicRendering()) {
+        inheritanceInfo.pNext = &renderingInfo;
+        return inheritanceInfo;
+    }
+    inheritanceInfo.renderPass = m_renderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = m_framebuffers[imageIndex];
+    return inheritanceInfo;
+}
+
+VkCommandBufferInheritanceRenderingInfo VulkanRenderer::CreateCommandBufferInheritanceRenderingInfo() const noexcept
+{
+    VkCommandBufferInheritanceRenderingInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &m_imageFormat;
+    renderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    return renderingInfo;
+}
+
+VkRenderPassBeginInfo VulkanRenderer::CreateRenderPassBeginInfo(size_t imageIndex,
+    const VkClearValue& clearValue) const noexcept
+{
+    VkRenderPassBeginInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = m_renderPass;
+    renderPassInfo.framebuffer = m_framebuffers[imageIndex];
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = m_extent;
+
+    renderPassInfo.clearValueCount = 1;
+    renderPassInfo.pClearValues = &clearValue;
+    return renderPassInfo;
+}
+
+VkRenderingAttachmentInfo VulkanRenderer::CreateRenderingAttachmentInfo(size_t imageIndex,
+    const VkClearValue& clearValue) const noexcept
+{
+    VkRenderingAttachmentInfo attachmentInfo = {};
+    attachmentInfo.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    attachmentInfo.imageView = m_imageViews[imageIndex];
+    attachmentInfo.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    attachmentInfo.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachmentInfo.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachmentInfo.clearValue = clearValue;
+    return attachmentInfo;
+}
+
+VkRenderingInfo VulkanRenderer::CreateRenderingInfo(const VkRenderingAttachmentInfo& colorAttachment,
+    VkSubpassContents contents) const noexcept
+{
+    VkRenderingInfo renderingInfo = {};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+        renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+    }
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = m_extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    return renderingInfo;
+}
+
+VkImageMemoryBarrier VulkanRenderer::CreateColorAttachmentBarrier(size_t imageIndex, VkImageLayout oldLayout,
+    VkImageLayout newLayout) const noexcept
+{
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_images[imageIndex];
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = 1;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = 1;
+    if (newLayout == VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL) {
+        barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    }
+    else {
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    }
+    return barrier;
+}
+
+// Begins rendering to the image, with a render pass and framebuffer or, with dynamic rendering,
+// with the layout transition that the render pass would have made.
+void VulkanRenderer::BeginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex,
+    const VkClearValue& clearValue, VkSubpassContents contents)
+{
+    if (!m_context->UsesDynamicRendering()) {
+        VkRenderPassBeginInfo renderPassInfo = CreateRenderPassBeginInfo(imageIndex, clearValue);
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, contents);
+        return;
+    }
+    // the previous contents are cleared, so the old layout does not matter; waiting for colour
+    // output chains to the acquire semaphore's wait stage
+    VkImageMemoryBarrier barrier = CreateColorAttachmentBarrier(imageIndex, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    VkRenderingAttachmentInfo colorAttachment = CreateRenderingAttachmentInfo(imageIndex, clearValue);
+    VkRenderingInfo renderingInfo = CreateRenderingInfo(colorAttachment, contents);
+    m_context->CmdBeginRendering(commandBuffer, renderingInfo);
+}
+
+void VulkanRenderer::EndRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+    if (!m_context->UsesDynamicRendering()) {
+        vkCmdEndRenderPass(commandBuffer);
+        return;
+    }
+    m_context->CmdEndRendering(commandBuffer);
+    // the render pass's final layout; later barriers, the present and the readback copy chain to
+    // colour output
+    VkImageMemoryBarrier barrier = CreateColorAttachmentBarrier(imageIndex,
+        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, m_finalLayout);
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+        VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void VulkanRenderer::CreateCommandBuffers()
+{
+    QueueFamilyIndices queueFamilyIndices = FindQueueFamilies(m_physicalDevice);
+    VkCommandPoolCreateInfo poolInfo = CreateCommandPoolCreateInfo(queueFamilyIndices);
+    for (auto& frame : m_frames) {
+        VkResult result = vkCreateCommandPool(m_logicalDevice, &poolInfo, nullptr, &frame.commandPool);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create command pool:");
+        }
+        VkCommandBufferAllocateInfo allocInfo = CreateCommandBufferAllocateInfo(frame.commandPool);
+        result = vkAllocateCommandBuffers(m_logicalDevice, &allocInfo, &frame.commandBuffer);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to allocate command buffers:");
+        }
+    }
+}
+
+uint32_t VulkanRenderer::GetDrawCount() const noexcept
+{
+    if (m_instancesPerDraw == 0 || m_instanceCount == 0) {
+        return 1;
+    }
+    return (m_instanceCount + m_instancesPerDraw - 1) / m_instancesPerDraw;
+}
+
+// Secondary command buffers inherit nothing but the render pass, so every slice binds all of its state.
+void VulkanRenderer::RecordDraws(VkCommandBuffer commandBuffer, uint32_t uniformOffset,
+    uint32_t firstDraw, uint32_t endDraw) const noexcept
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_graphicsPipeline);
+    VkViewport viewport = CreateViewport();
+    VkRect2D scissor = CreateScissor();
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+    VkBuffer vertexBuffers[] = { m_vertexBuffer.buffer, m_instanceBuffer.buffer };
+    VkDeviceSize vertexOffsets[] = { 0, 0 };
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, vertexOffsets);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer.buffer, 0, VK_INDEX_TYPE_UINT32);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1,
+        &m_frameDescriptorSet, 1, &uniformOffset);
+    uint32_t instancesPerDraw = m_instancesPerDraw == 0 ? m_instanceCount : m_instancesPerDraw;
+    for (uint32_t draw = firstDraw; draw < endDraw; ++draw) {
+        DrawConstants constants;
+        WriteDrawConstants(draw, constants);
+        vkCmdPushConstants(commandBuffer, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants),
+            &constants);
+        uint32_t firstInstance = draw * instancesPerDraw;
+        uint32_t instanceCount = std::min(instancesPerDraw, m_instanceCount - firstInstance);
+        vkCmdDrawIndexed(commandBuffer, m_indexCount, instanceCount, 0, 0, firstInstance);
+    }
+}
+
+// Records the frame slot's command buffer, or leaves it as it is when it was recorded for the same
+// scene, image and uniform offset and can simply be submitted again.
+void VulkanRenderer::RecordCommandBuffer(FrameData& frame, uint32_t imageIndex, SubmitWaits& waits)
+{
+    // RenderFrame advances m_currentFrame only after recording, so it is this command buffer's slot
+    uint32_t frameIndex = static_cast<uint32_t>(m_currentFrame);
+    UpdateGraphicsPipeline();
+    // this slot has just been waited for, so whatever was retired while it was in flight may be due
+    m_deletionQueue.Collect();
+    // the fence for this slot has signaled, so last time's transient data is no longer in use
+    m_frameArena.BeginFrame(frameIndex);
+    ArenaAllocation uniforms = m_frameArena.Allocate(sizeof(FrameUniforms));
+    WriteFrameUniforms(*static_cast<FrameUniforms*>(uniforms.data));
+    if (m_reuseCommandBuffers && frame.recordedSceneVersion == m_sceneVersion) {
+        if (frame.recordedImageIndex == imageIndex && frame.recordedUniformOffset == uniforms.offset) {
+            m_frameProfiler.ReuseRenderPassQueries(frameIndex);
+            ++m_recordingStatistics.framesReused;
+            return;
+        }
+        ++m_recordingStatistics.imageMisses;
+    }
+
+    // frees the primary's and any inline commands at once; the pool was created transient
+    VkCommandBuffer commandBuffer = frame.commandBuffer;
+    frame.recordedSceneVersion = 0;
+    VkResult result = vkResetCommandPool(m_logicalDevice, frame.commandPool, 0);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to reset command pool:");
+    }
+    VkCommandBufferBeginInfo beginInfo = CreateCommandBufferBeginInfo();
+    result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to begin recording command buffer:");
+    }
+
+    // take ownership of anything uploaded since the last frame before the render pass reads it
+    bool acquired = m_stagingUploader.RecordAcquire(commandBuffer, waits);
+    m_frameProfiler.WriteRenderPassBegin(commandBuffer, frameIndex);
+    uint32_t uniformOffset = static_cast<uint32_t>(uniforms.offset);
+    VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+    if (m_parallelRecorder.GetThreadCount() > 1) {
+        BeginRendering(commandBuffer, imageIndex, clearColor, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        VkCommandBufferInheritanceRenderingInfo renderingInfo = CreateCommandBufferInheritanceRenderingInfo();
+        VkCommandBufferInheritanceInfo inheritanceInfo = CreateCommandBufferInheritanceInfo(imageIndex,
+            renderingInfo);
+        const std::vector<VkCommandBuffer>& secondaries = m_parallelRecorder.Record(frameIndex, inheritanceInfo,
+            GetDrawCount(), [&](VkCommandBuffer secondary, uint32_t firstDraw, uint32_t endDraw) {
+                RecordDraws(secondary, uniformOffset, firstDraw, endDraw);
+            });
+        vkCmdExecuteCommands(commandBuffer, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+    }
+    else {
+        BeginRendering(commandBuffer, imageIndex, clearColor, VK_SUBPASS_CONTENTS_INLINE);
+        RecordDraws(commandBuffer, uniformOffset, 0, GetDrawCount());
+    }
+    EndRendering(commandBuffer, imageIndex);
+    m_frameProfiler.WriteRenderPassEnd(commandBuffer, frameIndex);
+    RecordAfterRenderPass(commandBuffer, imageIndex);
+
+    result = vkEndCommandBuffer(commandBuffer);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to record command buffer:");
+    }
+    ++m_recordingStatistics.framesRecorded;
+    // an ownership acquire must happen exactly once, so a command buffer holding one is not reused
+    frame.recordedSceneVersion = acquired ? 0 : m_sceneVersion;
+    frame.recordedImageIndex = imageIndex;
+    frame.recordedUniformOffset = uniforms.offset;
+}
+
+VkSemaphoreCreateInfo VulkanRenderer::CreateSemaphoreCreateInfo() const noexcept
+{
+    VkSemaphoreCreateInfo semaphoreInfo = {};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    return semaphoreInfo;
+}
+
+VkFenceCreateInfo VulkanRenderer::CreateFenceCreateInfo() const noexcept
+{
+    VkFenceCreateInfo fenceInfo = {};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    // created signaled so that the first wait on each frame slot returns immediately
+    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+    return fenceInfo;
+}
+
+void VulkanRenderer::CreateSyncObjects()
+{
+    VkSemaphoreCreateInfo semaphoreInfo = CreateSemaphoreCreateInfo();
+    VkFenceCreateInfo fenceInfo = CreateFenceCreateInfo();
+
+    for (auto& frame : m_frames) {
+        VkResult result = vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &frame.imageAvailableSemaphore);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create image available semaphore:");
+        }
+        result = vkCreateSemaphore(m_logicalDevice, &semaphoreInfo, nullptr, &frame.renderFinishedSemaphore);
+        if (result != VK_SUCCESS) {
+            throw VulkanException(result, "Failed to create render finished semaphore:");
+        }
+        // with timeline semaphores, frames signal the graphics queue's timeline instead
+        if (!m_context->UsesTimelineSemaphores()) {
+            result = vkCreateFence(m_logicalDevice, &fenceInfo, nullptr, &frame.inFlightFence);
+            if (result != VK_SUCCESS) {
+                throw VulkanException(result, "Failed to create in-flight fence:");
+            }
+        }
+        frame.submitted = SubmitPoint();
+    }
+    m_imagesInFlight.assign(m_images.size(), SubmitPoint());
+}
+
+std::string VulkanRenderer::GetDeviceName() const
+{
+    if (m_physicalDevice == VK_NULL_HANDLE) {
+        return std::string();
+    }
+    return m_context->GetDeviceSelector().GetInfo(m_physicalDevice).properties.deviceName;
+}
+
+void VulkanRenderer::CreateTimestampQueries()
+{
+    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+    m_frameProfiler.Create(m_logicalDevice, m_context->GetDeviceSelector().GetInfo(m_physicalDevice),
+        static_cast<uint32_t>(indices.graphicsFamily), static_cast<uint32_t>(m_frames.size()));
+}
+
+void VulkanRenderer::DestroyFrameResources() noexcept
+{
+    for (auto& frame : m_frames) {
+        // destroying the pool frees its command buffer
+        if (frame.commandPool != VK_NULL_HANDLE) {
+            vkDestroyCommandPool(m_logicalDevice, frame.commandPool, nullptr);
+        }
+        if (frame.imageAvailableSemaphore != VK_NULL_HANDLE) {
+            vkDestroySemaphore(m_logicalDevice, frame.imageAvailableSemaphore, nullptr);
+        }
+        if (frame.renderFinishedSemaphore != VK_NULL_HANDLE) {
+            vkDestroySemaphore(m_logicalDevice, frame.renderFinishedSemaphore, nullptr);
+        }
+        if (frame.inFlightFence != VK_NULL_HANDLE) {
+            vkDestroyFence(m_logicalDevice, frame.inFlightFence, nullptr);
+        }
+        frame = FrameData();
+    }
+    m_imagesInFlight.assign(m_imagesInFlight.size(), SubmitPoint());
+}
+
+void VulkanRenderer::SetFramesInFlight(uint32_t framesInFlight)
+{
+    if (framesInFlight == 0) {
+        throw std::runtime_error("Programming Error:\nAt least one frame must be allowed in flight.");
+    }
+    if (framesInFlight == m_frames.size()) {
+        return;
+    }
+    WaitForFramesInFlight();
+    // retired objects may be waiting on the fences that are about to be destroyed
+    m_deletionQueue.Flush();
+    DestroyFrameResources();
+    m_frames.resize(framesInFlight);
+    m_currentFrame = 0;
+    CreateCommandBuffers();
+    CreateSyncObjects();
+    CreateTimestampQueries();
+    CreateFrameArena();
+    CreateDescriptorSets();
+    if (m_parallelRecorder.GetThreadCount() > 0) {
+        CreateParallelRecorder(m_parallelRecorder.GetThreadCount());
+    }
+}
+
+void VulkanRenderer::SetRecordingThreads(uint32_t threadCount)
+{
+    if (threadCount == GetRecordingThreads()) {
+        return;
+    }
+    // the frames in flight may still be executing secondary command buffers from the old pools
+    WaitForFramesInFlight();
+    if (threadCount > 1) {
+        CreateParallelRecorder(threadCount);
+    }
+    else {
+        m_parallelRecorder.Destroy();
+    }
+    MarkSceneDirty();
+}
+
+void VulkanRenderer::CreateParallelRecorder(uint32_t threadCount)
+{
+    QueueFamilyIndices indices = FindQueueFamilies(m_physicalDevice);
+    m_parallelRecorder.Create(m_logicalDevice, static_cast<uint32_t>(indices.graphicsFamily),
+        static_cast<uint32_t>(m_frames.size()), threadCount);
+}
+
+void VulkanRenderer::SetInstancesPerDraw(uint32_t instancesPerDraw) noexcept
+{
+    m_instancesPerDraw = instancesPerDraw;
+    MarkSceneDirty();
+}
+
+void VulkanRenderer::WaitIdle() const
+{
+    VkResult result = vkDeviceWaitIdle(m_logicalDevice);
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed waiting for the device to become idle:");
+    }
+}
+
+std::vector<SubmitPoint> VulkanRenderer::GetFramesInFlight() const
+{
+    std::vector<SubmitPoint> points;
+    for (const auto& frame : m_frames) {
+        points.push_back(frame.submitted);
+    }
+    return points;
+}
+
+void VulkanRenderer::WaitForFramesInFlight()
+{
+    VkResult result = m_context->Wait(GetFramesInFlight());
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to wait for the frames in flight:");
+    }
+}
+
+void VulkanRenderer::WaitForSubmit(const SubmitPoint& point)
+{
+    if (point.IsNull()) {
+        return;
+    }
+    auto start = std::chrono::steady_clock::now();
+    VkResult result = m_context->Wait(point);
+    auto end = std::chrono::steady_clock::now();
+    if (result != VK_SUCCESS) {
+        throw VulkanException(result, "Failed to wait for an in-flight frame:");
+    }
+    m_fenceWaitStatistics.AddSample(std::chrono::duration<double, std::milli>(end - start).count());
+}
+
+
+void VulkanRenderer::CreatePipelineCache()
+{
+    m_context->CreatePipelineCache();
+}
+
+void VulkanRenderer::DestroyRenderPass() noexcept
+{
+    if (m_renderPass != VK_NULL_HANDLE) {
+        vkDestroyRenderPass(m_logicalDevice, m_renderPass, nullptr);
+        m_renderPass = VK_NULL_HANDLE;
+    }
+}
+
+// The registry keeps the pipeline, which other renderers may be using, until the context is
+// destroyed.
+void VulkanRenderer::DestroyGraphicsPipeline() noexcept
+{
+    // compile functions use this renderer and the render pass that is about to be replaced
+    m_context->GetPipelineRegistry().WaitForCompiles();
+    m_graphicsPipeline = VK_NULL_HANDLE;
+}
+
+void VulkanRenderer::DestroyImageViews() noexcept
+{
+    for (auto& imageView : m_imageViews) {
+        vkDestroyImageView(m_logicalDevice, imageView, nullptr);
+    }
+    m_imageViews.clear();
+}
+
+void VulkanRenderer::DestroyFrameBuffers() noexcept
+{
+    for (auto& framebuffer : m_framebuffers) {
+        vkDestroyFramebuffer(m_logicalDevice, framebuffer, nullptr);
+    }
+    m_framebuffers.clear();
+}
+
+void VulkanRenderer::RetireRenderPass()
+{
+    if (m_renderPass != VK_NULL_HANDLE) {
+        VkDevice device = m_logicalDevice;
+        VkRenderPass renderPass = m_renderPass;
+        m_deletionQueue.Retire(GetFramesInFlight(), [device, renderPass] {
+            vkDestroyRenderPass(device, renderPass, nullptr);
+        });
+        m_renderPass = VK_NULL_HANDLE;
+    }
+}
+
+void VulkanRenderer::RetireImageViews()
+{
+    VkDevice device = m_logicalDevice;
+    std::vector<VkImageView> imageViews;
+    imageViews.swap(m_imageViews);
+    m_deletionQueue.Retire(GetFramesInFlight(), [device, imageViews] {
+        for (auto& imageView : imageViews) {
+            vkDestroyImageView(device, imageView, nullptr);
+        }
+    });
+}
+
+void VulkanRenderer::RetireFrameBuffers()
+{
+    VkDevice device = m_logicalDevice;
+    std::vector<VkFramebuffer> framebuffers;
+    framebuffers.swap(m_framebuffers);
+    m_deletionQueue.Retire(GetFramesInFlight(), [device, framebuffers] {
+        for (auto& framebuffer : framebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+    });
+}
+
+void VulkanRenderer::RecordAfterRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex)
+{
+}
@@ -0,0 +1,354 @@
+#pragma once
+#include <vulkan/vulkan.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <map>
+#include <memory>
+#include "DeletionQueue.h"
+#include "DeviceMemoryAllocator.h"
+#include "FrameArena.h"
+#include "FrameProfiler.h"
+#include "InitScheduler.h"
+#include "ParallelRecorder.h"
+#include "PipelineCache.h"
+#include "ShaderBinaryProvider.h"
+#include "StagingUploader.h"
+#include "VulkanContext.h"
+#include "Vertex.h"
+
+struct QueueFamilyIndices {
+    int graphicsFamily = -1;
+    int presentFamily = -1;
+    // a family with transfer but no graphics support if there is one, otherwise graphicsFamily
+    int transferFamily = -1;
+
+    bool IsComplete() {
+        return graphicsFamily >= 0 && presentFamily >= 0;
+    }
+};
+
+// Per-frame resources for one slot in the frames-in-flight ring
+struct FrameData {
+    // a transient pool per slot, reset as a whole when the slot's command buffer is re-recorded
+    VkCommandPool commandPool = VK_NULL_HANDLE;
+    VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+    VkSemaphore imageAvailableSemaphore = VK_NULL_HANDLE;
+    VkSemaphore renderFinishedSemaphore = VK_NULL_HANDLE;
+    // only without timeline semaphores
+    VkFence inFlightFence = VK_NULL_HANDLE;
+    // where the slot's last submission completes: inFlightFence, a FrameCoordinator's fence, or a
+    // value on the graphics queue's timeline
+    SubmitPoint submitted;
+    // what commandBuffer was last recorded for; 0 means it must be recorded again
+    uint64_t recordedSceneVersion = 0;
+    uint32_t recordedImageIndex = 0;
+    VkDeviceSize recordedUniformOffset = 0;
+};
+
+// How often RenderFrame recorded a command buffer and how often it resubmitted one unchanged
+struct RecordingStatistics {
+    uint64_t framesRecorded = 0;
+    uint64_t framesReused = 0;
+    // the recorded frames whose scene was unchanged, but whose slot was last recorded for a
+    // different swapchain image or uniform offset
+    uint64_t imageMisses = 0;
+};
+
+// Per-frame shader constants, matching the uniform block in shader.vert
+struct FrameUniforms {
+    // column-major
+    float transform[16];
+    float seconds;
+    float rotationSpeed;
+    float padding[2];
+};
+
+// Per-draw shader constants, pushed before each draw; matches the push_constant block in shader.vert
+struct DrawConstants {
+    float tint[4];
+};
+
+// Time the CPU has spent blocked waiting for frames in flight, in milliseconds: in vkWaitForFences,
+// or in vkWaitSemaphores with timeline semaphores
+struct FenceWaitStatistics {
+    uint64_t waitCount = 0;
+    double lastMilliseconds = 0.0;
+    double maxMilliseconds = 0.0;
+    double totalMilliseconds = 0.0;
+
+    void AddSample(double milliseconds) {
+        ++waitCount;
+        lastMilliseconds = milliseconds;
+        maxMilliseconds = std::max(maxMilliseconds, milliseconds);
+        totalMilliseconds += milliseconds;
+    }
+
+    double AverageMilliseconds() const {
+        return waitCount == 0 ? 0.0 : totalMilliseconds / waitCount;
+    }
+};
+
+// Owns the Vulkan objects that do not depend on where the rendered images end up: render pass,
+// pipeline, command pools and the frames-in-flight ring. The instance, device and what else can
+// be shared between views live in a VulkanContext, which several renderers may share.
+// VulkanCanvas renders into a window surface; VulkanOffscreenRenderer renders into
+// device-local images without a window.
+class VulkanRenderer
+{
+public:
+    // With no context, the renderer creates its own; with the context of an existing renderer,
+    // it uses that renderer's instance and device instead of creating new ones.
+    VulkanRenderer(std::shared_ptr<VulkanContext> context = nullptr);
+    virtual ~VulkanRenderer() noexcept;
+
+    static const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+    void SetFramesInFlight(uint32_t framesInFlight);
+    void WaitIdle() const;
+    // Replaces the mesh that is drawn. The data is uploaded through the staging ring and is
+    // used from the next recorded frame on.
+    void SetMesh(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+    // Replaces the instances drawn; one indexed draw renders the mesh once per instance.
+    void SetInstances(const std::vector<InstanceData>& instances);
+    uint32_t GetInstanceCount() const noexcept { return m_instanceCount; }
+    // Splits the instances into draws of this many instances each; 0 draws them all at once.
+    void SetInstancesPerDraw(uint32_t instancesPerDraw) noexcept;
+    uint32_t GetDrawCount() const noexcept;
+    // With more than one thread, the draws are split into slices recorded into secondary command
+    // buffers on that many threads (including the rendering thread).
+    void SetRecordingThreads(uint32_t threadCount);
+    uint32_t GetRecordingThreads() const noexcept { return std::max(m_parallelRecorder.GetThreadCount(), 1u); }
+    // A frame slot's command buffer is only re-recorded when something it draws has changed
+    // since it was last recorded; the uniforms are rewritten every frame either way. Call
+    // MarkSceneDirty after changing anything else that the recorded commands depend on.
+    // The command buffer also names the swapchain image, so it is only reused when the slot
+    // acquires the same image as last time, which is rare unless the swapchain has as many
+    // images as there are frames in flight; see RecordingStatistics::imageMisses.
+    void SetReuseCommandBuffers(bool reuse) noexcept { m_reuseCommandBuffers = reuse; }
+    bool GetReuseCommandBuffers() const noexcept { return m_reuseCommandBuffers; }
+    void MarkSceneDirty() noexcept { ++m_sceneVersion; }
+    // Per-frame data, written to the frame's uniforms every frame without re-recording.
+    // The transform is a column-major 4x4 matrix applied after the instance transforms.
+    void SetViewTransform(const float transform[16]) noexcept;
+    void SetRotationSpeed(float radiansPerSecond) noexcept { m_rotationSpeed = radiansPerSecond; }
+    const RecordingStatistics& GetRecordingStatistics() const noexcept { return m_recordingStatistics; }
+    uint32_t GetFramesInFlight() const noexcept { return static_cast<uint32_t>(m_frames.size()); }
+    const FenceWaitStatistics& GetFenceWaitStatistics() const noexcept { return m_fenceWaitStatistics; }
+    const PipelineCacheStatistics& GetPipelineCacheStatistics() const noexcept
+    {
+        return m_context->GetPipelineCache().GetStatistics();
+    }
+    // for the whole context
+    PipelineRegistryStatistics GetPipelineRegistryStatistics() const
+    {
+        return m_context->GetPipelineRegistry().GetStatistics();
+    }
+    // Draws with a pipeline for state from the next recorded frame on. A pipeline that the context
+    // does not have yet is compiled on a worker thread, and the current one is used until it is ready.
+    void SetPipelineState(const PipelineState& state);
+    const PipelineState& GetPipelineState() const noexcept { return m_pipelineState; }
+    // for the whole context, including memory used by other renderers sharing it
+    MemoryStatistics GetMemoryStatistics() const noexcept { return m_context->GetMemoryAllocator().GetStatistics(); }
+    const FrameArenaStatistics& GetFrameArenaStatistics() const noexcept { return m_frameArena.GetStatistics(); }
+    const std::vector<InitStepTiming>& GetInitTimings() const noexcept { return m_initTimings; }
+    std::string GetDeviceName() const;
+    const StagingStatistics& GetStagingStatistics() const noexcept { return m_stagingUploader.GetStatistics(); }
+    FrameProfiler& GetFrameProfiler() noexcept { return m_frameProfiler; }
+    const FrameProfiler& GetFrameProfiler() const noexcept { return m_frameProfiler; }
+    const std::shared_ptr<VulkanContext>& GetContext() const noexcept { return m_context; }
+
+protected:
+    void RunInitSteps(InitScheduler& scheduler);
+    void InitializeInstance(const std::string& appName, const std::vector<const char*>& requiredExtensions);
+    void InitializeVulkan(std::vector<const char*> extensions);
+    void CreateInstance(const VkInstanceCreateInfo& createInfo);
+    void PickPhysicalDevice();
+    void CreateLogicalDevice();
+    // Used instead of the steps that create the instance, device, pipeline cache and memory
+    // allocator when the context was created by another renderer.
+    void AttachContext(const std::vector<const char*>& instanceExtensions);
+    // For a shared context, once the surface exists
+    void SelectPresentQueue();
+    void CreatePipelineCache();
+    void CreateMemoryAllocator();
+    void CreateStagingUploader();
+    void CreateMeshBuffers();
+    void DestroyMeshBuffers() noexcept;
+    void ReplaceDeviceBuffer(AllocatedBuffer& buffer, const void* data, VkDeviceSize size,
+        VkBufferUsageFlags usage, VkAccessFlags dstAccess);
+    void CreateDescriptorSetLayout();
+    void CreateFrameArena();
+    void CreateDescriptorSets();
+    void DestroyDescriptors() noexcept;
+    // Fills the uniforms in the frame arena; called for every frame.
+    virtual void WriteFrameUniforms(FrameUniforms& uniforms) const noexcept;
+    // Fills the push constants for one draw. May be called on several recording threads at once,
+    // and the result is kept in reused command buffers until MarkSceneDirty is called.
+    virtual void WriteDrawConstants(uint32_t draw, DrawConstants& constants) const noexcept;
+    void LoadShaders(const std::vector<std::string>& names);
+    void CreateImageViews();
+    void CreateRenderPass();
+    // Gets the pipeline for the current pipeline state from the context's registry, compiling it
+    // on this thread if the registry does not have it.
+    void CreateGraphicsPipeline(const std::string& vertexShaderFile, const std::string& fragmentShaderFile);
+    PipelineRegistry::Compile CreatePipelineCompile(const PipelineKey& key) const;
+    VkPipeline CompileGraphicsPipeline(const PipelineKey& key, VkRenderPass renderPass) const;
+    void UpdateGraphicsPipeline();
+    void CreateFrameBuffers();
+    void CreateCommandBuffers();
+    void CreateSyncObjects();
+    void CreateTimestampQueries();
+    void DestroyRenderPass() noexcept;
+    void DestroyGraphicsPipeline() noexcept;
+    void DestroyImageViews() noexcept;
+    void DestroyFrameBuffers() noexcept;
+    // Hand the objects to the deletion queue, to be destroyed once the frames in flight have completed.
+    void RetireRenderPass();
+    void RetireImageViews();
+    void RetireFrameBuffers();
+    void DestroyFrameResources() noexcept;
+    void CreateParallelRecorder(uint32_t threadCount);
+    void RecordCommandBuffer(FrameData& frame, uint32_t imageIndex, SubmitWaits& waits);
+    void RecordDraws(VkCommandBuffer commandBuffer, uint32_t uniformOffset,
+        uint32_t firstDraw, uint32_t endDraw) const noexcept;
+    void BeginRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, const VkClearValue& clearValue,
+        VkSubpassContents contents);
+    void EndRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    virtual void RecordAfterRenderPass(VkCommandBuffer commandBuffer, uint32_t imageIndex);
+    void WaitForSubmit(const SubmitPoint& point);
+    void WaitForFramesInFlight();
+    // where the frames that have been submitted complete; the points that retired objects wait for
+    std::vector<SubmitPoint> GetFramesInFlight() const;
+    VkDeviceQueueCreateInfo CreateDeviceQueueCreateInfo(int queueFamily) const noexcept;
+    VkApplicationInfo CreateApplicationInfo(const std::string& appName,
+        const int32_t appVersion = VK_MAKE_VERSION(1, 0, 0),
+        const std::string& engineName = "No Engine",
+        const int32_t engineVersion = VK_MAKE_VERSION(1, 0, 0),
+        const int32_t apiVersion = VK_API_VERSION_1_0) const noexcept;
+    VkInstanceCreateInfo CreateInstanceCreateInfo(const VkApplicationInfo& appInfo,
+        const std::vector<const char*>& extensionNames,
+        const std::vector<const char*>& layerNames) const noexcept;
+    std::vector<VkDeviceQueueCreateInfo> CreateQueueCreateInfos(
+        const std::set<int>& uniqueQueueFamilies) const noexcept;
+    VkDeviceCreateInfo CreateDeviceCreateInfo(
+        const std::vector<VkDeviceQueueCreateInfo>& queueCreateInfos,
+        const VkPhysicalDeviceFeatures& deviceFeatures) const noexcept;
+    VkImageViewCreateInfo CreateImageViewCreateInfo(uint32_t imageIndex) const noexcept;
+    VkAttachmentDescription CreateAttachmentDescription() const noexcept;
+    VkAttachmentReference CreateAttachmentReference() const noexcept;
+    VkSubpassDescription CreateSubpassDescription(const VkAttachmentReference& attachmentRef) const noexcept;
+    VkSubpassDependency CreateSubpassDependency() const noexcept;
+    VkRenderPassCreateInfo CreateRenderPassCreateInfo(
+        const VkAttachmentDescription& colorAttachment,
+        const VkSubpassDescription& subPass,
+        const VkSubpassDependency& dependency) const noexcept;
+    VkPipelineShaderStageCreateInfo CreatePipelineShaderStageCreateInfo(
+        VkShaderStageFlagBits stage, VkShaderModule& module, const char* entryName,
+        const VkSpecializationInfo* specializationInfo = nullptr) const noexcept;
+    VkPipelineVertexInputStateCreateInfo CreatePipelineVertexInputStateCreateInfo(
+        const std::array<VkVertexInputBindingDescription, 2>& bindingDescriptions,
+        const std::array<VkVertexInputAttributeDescription, 4>& attributeDescriptions) const noexcept;
+    VkViewport CreateViewport() const noexcept;
+    VkRect2D CreateScissor() const noexcept;
+    VkPipelineViewportStateCreateInfo CreatePipelineViewportStateCreateInfo() const noexcept;
+    VkPipelineDynamicStateCreateInfo CreatePipelineDynamicStateCreateInfo() const noexcept;
+    VkPipelineMultisampleStateCreateInfo CreatePipelineMultisampleStateCreateInfo() const noexcept;
+    VkPipelineColorBlendStateCreateInfo CreatePipelineColorBlendStateCreateInfo(
+        const VkPipelineColorBlendAttachmentState& colorBlendAttachment) const noexcept;
+    VkPushConstantRange CreatePushConstantRange() const noexcept;
+    VkDescriptorSetLayoutBinding CreateDescriptorSetLayoutBinding() const noexcept;
+    VkDescriptorSetLayoutCreateInfo CreateDescriptorSetLayoutCreateInfo(
+        const VkDescriptorSetLayoutBinding& binding) const noexcept;
+    VkDescriptorPoolCreateInfo CreateDescriptorPoolCreateInfo(const VkDescriptorPoolSize& poolSize) const noexcept;
+    VkDescriptorSetAllocateInfo CreateDescriptorSetAllocateInfo() const noexcept;
+    VkGraphicsPipelineCreateInfo CreateGraphicsPipelineCreateInfo(
+        const VkPipelineShaderStageCreateInfo shaderStages[],
+        const VkPipelineVertexInputStateCreateInfo& vertexInputInfo,
+        const VkPipelineInputAssemblyStateCreateInfo& inputAssembly,
+        const VkPipelineViewportStateCreateInfo& viewportState,
+        const VkPipelineRasterizationStateCreateInfo& rasterizer,
+        const VkPipelineMultisampleStateCreateInfo& multisampling,
+        const VkPipelineColorBlendStateCreateInfo& colorBlending,
+        const VkPipelineDynamicStateCreateInfo& dynamicState,
+        VkPipelineLayout layout, VkRenderPass renderPass) const noexcept;
+    VkPipelineRenderingCreateInfo CreatePipelineRenderingCreateInfo(const VkFormat& colorFormat) const noexcept;
+    VkFramebufferCreateInfo CreateFramebufferCreateInfo(
+        const VkImageView& attachments) const noexcept;
+    VkCommandPoolCreateInfo CreateCommandPoolCreateInfo(QueueFamilyIndices& queueFamilyIndices) const noexcept;
+    VkCommandBufferAllocateInfo CreateCommandBufferAllocateInfo(VkCommandPool commandPool) const noexcept;
+    VkCommandBufferBeginInfo CreateCommandBufferBeginInfo() const noexcept;
+    VkCommandBufferInheritanceInfo CreateCommandBufferInheritanceInfo(size_t imageIndex,
+        const VkCommandBufferInheritanceRenderingInfo& renderingInfo) const noexcept;
+    VkCommandBufferInheritanceRenderingInfo CreateCommandBufferInheritanceRenderingInfo() const noexcept;
+    VkRenderPassBeginInfo CreateRenderPassBeginInfo(size_t imageIndex,
+        const VkClearValue& clearValue) const noexcept;
+    VkRenderingAttachmentInfo CreateRenderingAttachmentInfo(size_t imageIndex,
+        const VkClearValue& clearValue) const noexcept;
+    VkRenderingInfo CreateRenderingInfo(const VkRenderingAttachmentInfo& colorAttachment,
+        VkSubpassContents contents) const noexcept;
+    VkImageMemoryBarrier CreateColorAttachmentBarrier(size_t imageIndex, VkImageLayout oldLayout,
+        VkImageLayout newLayout) const noexcept;
+    VkSemaphoreCreateInfo CreateSemaphoreCreateInfo() const noexcept;
+    VkFenceCreateInfo CreateFenceCreateInfo() const noexcept;
+    virtual bool IsDeviceSuitable(const VkPhysicalDevice& device) const;
+    QueueFamilyIndices FindQueueFamilies(const VkPhysicalDevice& device) const;
+    bool CheckDeviceExtensionSupport(const VkPhysicalDevice& device) const;
+
+    // declared first so that it is destroyed last
+    std::shared_ptr<VulkanContext> m_context;
+    bool m_vulkanInitialized;
+    // the context's handles, copied for convenience
+    VkInstance m_instance;
+    // VK_NULL_HANDLE when rendering offscreen
+    VkSurfaceKHR m_surface;
+    VkPhysicalDevice m_physicalDevice;
+    VkDevice m_logicalDevice;
+    VkQueue m_graphicsQueue;
+    VkQueue m_presentQueue;
+    VkQueue m_transferQueue;
+    std::vector<const char*> m_deviceExtensions;
+    std::vector<VkImage> m_images;
+    VkFormat m_imageFormat;
+    VkExtent2D m_extent;
+    VkImageLayout m_finalLayout;
+    std::vector<VkImageView> m_imageViews;
+    // VK_NULL_HANDLE, as are the framebuffers, with dynamic rendering
+    VkRenderPass m_renderPass;
+    // owned by the context and shared with its other renderers, as is m_descriptorSetLayout
+    VkPipelineLayout m_pipelineLayout;
+    // owned by the context's pipeline registry; the pipeline for m_pipelineKey
+    VkPipeline m_graphicsPipeline;
+    PipelineKey m_pipelineKey;
+    // what SetPipelineState asked for; differs from m_pipelineKey.state while it compiles
+    PipelineState m_pipelineState;
+    std::vector<VkFramebuffer> m_framebuffers;
+    ParallelRecorder m_parallelRecorder;
+    StagingUploader m_stagingUploader;
+    DeletionQueue m_deletionQueue;
+    AllocatedBuffer m_vertexBuffer;
+    AllocatedBuffer m_indexBuffer;
+    uint32_t m_indexCount;
+    AllocatedBuffer m_instanceBuffer;
+    uint32_t m_instanceCount;
+    uint32_t m_instancesPerDraw;
+    // bumped whenever recorded command buffers go stale
+    uint64_t m_sceneVersion;
+    bool m_reuseCommandBuffers;
+    RecordingStatistics m_recordingStatistics;
+    FrameArena m_frameArena;
+    float m_viewTransform[16];
+    float m_rotationSpeed;
+    std::chrono::steady_clock::time_point m_startTime;
+    VkDescriptorSetLayout m_descriptorSetLayout;
+    VkDescriptorPool m_descriptorPool;
+    VkDescriptorSet m_frameDescriptorSet;
+    std::vector<FrameData> m_frames;
+    std::vector<SubmitPoint> m_imagesInFlight;
+    size_t m_currentFrame;
+    FenceWaitStatistics m_fenceWaitStatistics;
+    FrameProfiler m_frameProfiler;
+    std::vector<InitStepTiming> m_initTimings;
+};
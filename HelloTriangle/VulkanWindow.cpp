@@ -1,12 +1,32 @@
 #include "VulkanWindow.h"
 #include "VulkanException.h"
 
-VulkanWindow::VulkanWindow(wxWindow* parent, wxWindowID id, const wxString &title)
-    : wxFrame(parent, id, title), m_canvas(nullptr)
+VulkanWindow::VulkanWindow(wxWindow* parent, wxWindowID id, const wxString &title, int viewCount)
+    : wxFrame(parent, id, title)
 {
+    if (viewCount < 1) {
+        throw std::runtime_error("Programming Error:\nA VulkanWindow needs at least one view.");
+    }
     Bind(wxEVT_SIZE, &VulkanWindow::OnResize, this);
-    m_canvas = new VulkanCanvas(this, wxID_ANY, wxDefaultPosition, { 800, 600 });
-    Fit();
+    wxBoxSizer* sizer = new wxBoxSizer(wxHORIZONTAL);
+    for (int i = 0; i < viewCount; i++) {
+        // the first canvas creates the device; the others attach to it
+        std::shared_ptr<VulkanContext> context = m_canvases.empty() ? nullptr : m_canvases[0]->GetContext();
+        VulkanCanvas* canvas = new VulkanCanvas(this, wxID_ANY, wxDefaultPosition,
+            { 800 / viewCount, 600 }, 0, "VulkanCanvasName", context);
+        sizer->Add(canvas, 1, wxEXPAND);
+        m_canvases.push_back(canvas);
+    }
+    if (viewCount > 1) {
+        m_coordinator = std::make_unique<FrameCoordinator>(m_canvases[0]->GetContext());
+        for (auto canvas : m_canvases) {
+            m_coordinator->AddCanvas(canvas);
+        }
+    }
+    // rendering stays paint-driven until a different RenderLoopMode is selected; with a
+    // coordinator, rendering the first canvas renders them all
+    m_renderLoop = std::make_unique<RenderLoop>(m_canvases[0]);
+    SetSizerAndFit(sizer);
 }
 
 
@@ -16,6 +36,6 @@ VulkanWindow::~VulkanWindow()
 
 void VulkanWindow::OnResize(wxSizeEvent& event)
 {
-    wxSize clientSize = GetClientSize();
-    m_canvas->SetSize(clientSize);
+    // the sizer shares the client area between the canvases
+    Layout();
 }
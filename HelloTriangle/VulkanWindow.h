@@ -1,16 +1,24 @@
 #pragma once
 #include "wx/wxprec.h"
 #include "VulkanCanvas.h"
+#include "FrameCoordinator.h"
+#include "RenderLoop.h"
+#include <memory>
+#include <vector>
 
 class VulkanWindow :
     public wxFrame
 {
 public:
-    VulkanWindow(wxWindow* parent, wxWindowID id, const wxString &title);
+    // With more than one view, the canvases sit side by side, share one VulkanContext and
+    // are submitted and presented together by a FrameCoordinator.
+    VulkanWindow(wxWindow* parent, wxWindowID id, const wxString &title, int viewCount = 1);
     virtual ~VulkanWindow();
 
 private:
     void OnResize(wxSizeEvent& event);
-    VulkanCanvas* m_canvas;
+    std::vector<VulkanCanvas*> m_canvases;
+    std::unique_ptr<FrameCoordinator> m_coordinator;
+    std::unique_ptr<RenderLoop> m_renderLoop;
 };
 
@@ -1,10 +1,18 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+// the variant, chosen when the pipeline is compiled; see FragmentVariant in PipelinePresets.h
+layout(constant_id = 0) const bool grayscale = false;
+layout(constant_id = 1) const float opacity = 1.0;
+
 layout(location = 0) in vec3 fragColor;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-    outColor = vec4(fragColor, 1.0);
+    vec3 color = fragColor;
+    if (grayscale) {
+        color = vec3(dot(color, vec3(0.2126, 0.7152, 0.0722)));
+    }
+    outColor = vec4(color, opacity);
 }
\ No newline at end of file
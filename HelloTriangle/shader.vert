@@ -1,25 +1,34 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
 
+layout(set = 0, binding = 0) uniform FrameUniforms {
+    mat4 transform;
+    float seconds;
+    // radians per second added to every instance's rotation
+    float rotationSpeed;
+} frame;
+
+layout(push_constant) uniform DrawConstants {
+    vec4 tint;
+} draw;
+
+layout(location = 0) in vec2 inPosition;
+layout(location = 1) in vec3 inColor;
+// per instance: xy offset, z scale, w rotation in radians
+layout(location = 2) in vec4 inInstanceTransform;
+layout(location = 3) in vec4 inInstanceColor;
+
 out gl_PerVertex {
     vec4 gl_Position;
 };
 
 layout(location = 0) out vec3 fragColor;
 
-vec2 positions[3] = vec2[](
-    vec2(0.0, -0.5),
-    vec2(0.5, 0.5),
-    vec2(-0.5, 0.5)
-);
-
-vec3 colors[3] = vec3[](
-    vec3(1.0, 0.0, 0.0),
-    vec3(0.0, 1.0, 0.0),
-    vec3(0.0, 0.0, 1.0)
-);
-
 void main() {
-    gl_Position = vec4(positions[gl_VertexIndex], 0.0, 1.0);
-    fragColor = colors[gl_VertexIndex];
-} 
\ No newline at end of file
+    float rotation = inInstanceTransform.w + frame.rotationSpeed * frame.seconds;
+    float c = cos(rotation);
+    float s = sin(rotation);
+    vec2 position = mat2(c, s, -s, c) * inPosition * inInstanceTransform.z + inInstanceTransform.xy;
+    gl_Position = frame.transform * vec4(position, 0.0, 1.0);
+    fragColor = inColor * inInstanceColor.rgb * draw.tint.rgb;
+}
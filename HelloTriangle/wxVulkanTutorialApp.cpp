@@ -4,6 +4,7 @@
 #include "VulkanWindow.h"
 #include "VulkanException.h"
 
+#ifdef _WIN32
 #pragma warning(disable: 28251)
 
 #ifdef _UNICODE
@@ -19,6 +20,7 @@
 #pragma comment(lib, "wxbase31.lib")
 #endif
 #endif
+#endif
 
 wxVulkanTutorialApp::wxVulkanTutorialApp()
 {
@@ -30,9 +32,17 @@ wxVulkanTutorialApp::~wxVulkanTutorialApp()
 
 bool wxVulkanTutorialApp::OnInit()
 {
+    // --views N shows N canvases that are rendered and presented together
+    int viewCount = 1;
+    for (int i = 1; i + 1 < argc; i++) {
+        long value;
+        if (argv[i] == "--views" && argv[i + 1].ToLong(&value) && value > 0) {
+            viewCount = static_cast<int>(value);
+        }
+    }
     VulkanWindow* mainFrame;
     try {
-        mainFrame = new VulkanWindow(nullptr, wxID_ANY, L"VulkanApp");
+        mainFrame = new VulkanWindow(nullptr, wxID_ANY, L"VulkanApp", viewCount);
     } 
     catch(VulkanException& ve) {
         std::string status = ve.GetStatus();